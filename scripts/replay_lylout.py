@@ -0,0 +1,50 @@
+"""Replays LYLOUT files into a directory the way the network writes them, for trying out Open > Live.
+
+usage: python scripts/replay_lylout.py OUTPUT_DIR FILE [FILE ...] [--rate SOURCES_PER_SECOND] [--batch LINES]
+
+The header of each file is written at once, the data lines are then appended in batches
+(the last line of a batch is sometimes split in two writes to exercise partial line handling).
+"""
+
+import argparse
+import os
+import random
+import time
+
+
+def replay(path, output_dir, rate, batch):
+    with open(path, "r") as source:
+        lines = source.readlines()
+
+    data_start = next((i + 1 for i, line in enumerate(lines) if line.startswith("*** data ***")), len(lines))
+    target = os.path.join(output_dir, os.path.basename(path))
+    with open(target, "w") as out:
+        out.writelines(lines[:data_start])
+        out.flush()
+        for first in range(data_start, len(lines), batch):
+            chunk = "".join(lines[first:first + batch])
+            split = random.randint(0, len(chunk))
+            out.write(chunk[:split])
+            out.flush()
+            time.sleep(0.01)
+            out.write(chunk[split:])
+            out.flush()
+            time.sleep(batch / rate)
+    print(f"replayed {len(lines) - data_start} sources into {target}")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("output_dir")
+    parser.add_argument("files", nargs="+")
+    parser.add_argument("--rate", type=float, default=20000.0)
+    parser.add_argument("--batch", type=int, default=2000)
+    args = parser.parse_args()
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    for path in args.files:
+        replay(path, args.output_dir, args.rate, args.batch)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,251 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <duckdb.hpp>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <bit>
+#include <cstring>
+#include <cstdlib>
+#include "state.h"
+#include "lylout.h"
+
+// renders synthetic source sets through the same query, upload and render path as the app and reports throughput,
+// optionally comparing every plot against golden images so faster is never allowed to mean wrong
+
+namespace
+{
+    constexpr int plot_width = 1024, plot_height = 512;
+    constexpr int skipped = 77; // ctest SKIP_RETURN_CODE, no golden images to compare against yet
+
+    void Synthesize(size_t count, Sources &sources)
+    {
+        // a deterministic storm: sorted times over ten minutes, a few cells drifting east, 12 stations
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        auto uniform = [&seed]()
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return static_cast<float>(seed >> 40) / static_cast<float>(1 << 24);
+        };
+        auto normal = [&uniform]()
+        {
+            return (uniform() + uniform() + uniform() + uniform() - 2.0f) * 1.7f;
+        };
+        int64_t day_epoch = 1716854400; // 2024-05-28
+        sources.Clear();
+        sources.station_order = "ABCDEFGHIJKL";
+        for (size_t i = 0; i < count; i++)
+        {
+            double seconds = 600.0 * static_cast<double>(i) / static_cast<double>(count);
+            float cell = std::floor(uniform() * 4.0f);
+            uint32_t mask = 0;
+            for (int station = 0; station < 12; station++)
+                if (uniform() < 0.7f)
+                    mask |= 1u << station;
+            sources.datetime.push_back(day_epoch * 1000000000LL + static_cast<int64_t>(seconds * 1E9));
+            sources.lat.push_back(34.5f + cell * 0.3f + normal() * 0.05f);
+            sources.lon.push_back(-98.0f + cell * 0.4f + static_cast<float>(seconds) * 0.0005f + normal() * 0.05f);
+            sources.alt.push_back(std::clamp(7.0f + normal() * 3.0f, 0.0f, 19.0f));
+            sources.chi.push_back(uniform() * 5.0f);
+            sources.pdb.push_back(-10.0f + uniform() * 50.0f);
+            sources.number_stations.push_back(static_cast<uint8_t>(std::popcount(mask)));
+            sources.mask.push_back(mask);
+        }
+    }
+
+    bool CompareGolden(const std::string &path, const std::vector<unsigned char> &pixels, int width, int height, bool record)
+    {
+        // only --record writes golden images, a missing one fails so a fresh checkout can never pass by default;
+        // comparisons allow a few stray pixels for driver rounding differences
+        if (record)
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << "P6\n" << width << " " << height << "\n255\n";
+            for (size_t i = 0; i < pixels.size(); i += 4)
+                out.write(reinterpret_cast<const char *>(&pixels[i]), 3);
+            std::cout << "  recorded " << path << "\n";
+            return static_cast<bool>(out);
+        }
+        std::ifstream golden(path, std::ios::binary);
+        if (!golden)
+        {
+            std::cout << "  FAILED " << path << ": no golden image, record one with --record\n";
+            return false;
+        }
+        std::string magic;
+        int golden_width = 0, golden_height = 0, max_value = 0;
+        golden >> magic >> golden_width >> golden_height >> max_value;
+        golden.get();
+        if (magic != "P6" || golden_width != width || golden_height != height)
+        {
+            std::cout << "  FAILED " << path << ": golden image is " << golden_width << "x" << golden_height << "\n";
+            return false;
+        }
+        std::vector<unsigned char> expected(static_cast<size_t>(width) * height * 3);
+        golden.read(reinterpret_cast<char *>(expected.data()), expected.size());
+        size_t different = 0;
+        for (size_t pixel = 0; pixel < expected.size() / 3; pixel++)
+            for (int channel = 0; channel < 3; channel++)
+                if (std::abs(int(expected[pixel * 3 + channel]) - int(pixels[pixel * 4 + channel])) > 8)
+                {
+                    different++;
+                    break;
+                }
+        double fraction = static_cast<double>(different) / (static_cast<double>(width) * height);
+        if (fraction > 0.001)
+        {
+            std::cout << "  FAILED " << path << ": " << different << " pixels differ\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_sources = 1000000;
+    int frames = 10;
+    std::string golden_directory;
+    bool osmesa = false, record = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!std::strcmp(argv[i], "--max") && i + 1 < argc)
+            max_sources = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--frames") && i + 1 < argc)
+            frames = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--golden") && i + 1 < argc)
+            golden_directory = argv[++i];
+        else if (!std::strcmp(argv[i], "--osmesa"))
+            osmesa = true;
+        else if (!std::strcmp(argv[i], "--record"))
+            record = true;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--max sources] [--frames n] [--golden directory [--record]] [--osmesa]\n";
+            return 2;
+        }
+    }
+
+    if (!golden_directory.empty() && !record && !std::filesystem::is_directory(golden_directory))
+    {
+        std::cout << "no golden images in " << golden_directory << ", record them with --record\n";
+        return skipped;
+    }
+
+    // a hidden window is enough for the fbos, --osmesa renders without any display (e.g. Mesa llvmpipe in CI)
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+    if (osmesa)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+    if (osmesa)
+    {
+        std::cerr << "--osmesa needs GLFW 3.4 or newer\n";
+        return 2;
+    }
+#endif
+    if (!glfwInit())
+    {
+        std::cerr << "Failed to initialize GLFW\n";
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+    if (osmesa)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+    GLFWwindow *window = glfwCreateWindow(64, 64, "Aggie XLMA Benchmark", nullptr, nullptr);
+    if (!window)
+    {
+        std::cerr << "Failed to create GLFW window\n";
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK)
+    {
+        std::cerr << "Failed to initialize GLEW\n";
+        return 1;
+    }
+    std::cout << "renderer: " << reinterpret_cast<const char *>(glGetString(GL_RENDERER)) << "\n";
+
+    duckdb::DuckDB db(nullptr);
+    duckdb::Connection con(db);
+    State state;
+    struct Named
+    {
+        const char *name;
+        State::Plot &plot;
+    };
+    std::array<Named, 4> plots = {{{"time_alt", state.time_alt}, {"lon_alt", state.lon_alt}, {"lon_lat", state.lon_lat}, {"alt_lat", state.alt_lat}}};
+    if (record && !golden_directory.empty())
+        std::filesystem::create_directories(golden_directory);
+
+    using Clock = std::chrono::steady_clock;
+    auto seconds_since = [](Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+    bool passed = true;
+    Sources sources;
+    for (size_t count = 10000; count <= max_sources; count *= 10)
+    {
+        Synthesize(count, sources);
+        con.Query("DROP TABLE IF EXISTS lma");
+        CreateLMA(con);
+        AppendSources(con, sources);
+
+        auto start = Clock::now();
+        auto result = con.Query(state.FilterQuery("TRUE", "MIN(time) OVER ()"));
+        double query_seconds = seconds_since(start);
+
+        start = Clock::now();
+        state.Draw(result);
+        glFinish();
+        double upload_seconds = seconds_since(start);
+
+        for (auto &named : plots)
+        {
+            named.plot.width = plot_width;
+            named.plot.height = plot_height;
+        }
+        state.Render(); // allocates the fbo textures outside of the timing
+        glFinish();
+        start = Clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            state.Invalidate();
+            state.Render();
+        }
+        glFinish();
+        double render_seconds = seconds_since(start);
+
+        double upload_mb = static_cast<double>(state.graphics.sources * State::AttributeCount * sizeof(float)) / (1024.0 * 1024.0);
+        double points = static_cast<double>(state.graphics.sources) * plots.size() * frames;
+        std::printf("%9zu sources (%zu plotted): query %8.2f ms, upload %8.2f ms (%8.1f MB/s), render %10.3g points/s\n",
+                    count, state.graphics.sources, query_seconds * 1E3, upload_seconds * 1E3, upload_mb / upload_seconds, points / render_seconds);
+
+        if (!golden_directory.empty())
+        {
+            std::vector<unsigned char> pixels(static_cast<size_t>(plot_width) * plot_height * 4);
+            for (auto &named : plots)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, named.plot.fbo);
+                glReadPixels(0, 0, plot_width, plot_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+                std::string path = golden_directory + "/" + named.name + "_" + std::to_string(count) + ".ppm";
+                passed &= CompareGolden(path, pixels, plot_width, plot_height, record);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+#include "grid.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+#include <functional>
+#include <glm/glm.hpp>
+
+namespace
+{
+    struct Binned // a source in the order of its time bin
+    {
+        float lon, lat, alt;
+    };
+
+    void Parallel(size_t count, const std::function<void(size_t, size_t, size_t)> &work)
+    {
+        // splits [0, count) evenly over the cores, work gets (thread, first, last)
+        size_t workers = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), count));
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < workers; i++)
+            threads.emplace_back(work, i, count * i / workers, count * (i + 1) / workers);
+        work(0, 0, count / workers);
+        for (auto &thread : threads)
+            thread.join();
+    }
+}
+
+bool Grid::Compute(duckdb::MaterializedQueryResult &res, size_t extents, std::string &error)
+{
+    Clear();
+    if (res.RowCount() == 0)
+    {
+        error = "Nothing to grid with current selection";
+        return false;
+    }
+
+    // mesh from the extents of the filtered sources, cells are square in km at the middle latitude;
+    // bins start on clock multiples of their length so grids line up with each other and with lmatools
+    double first_time = res.GetValue<double>(extents, 0);
+    double bin_ns = minutes * 60.0 * 1E9;
+    time_origin = std::floor(first_time / bin_ns) * bin_ns;
+    float offset = static_cast<float>((first_time - time_origin) * 1E-9); // the query's times are relative to the first source
+    double seconds = (res.GetValue<double>(extents + 1, 0) - time_origin) * 1E-9;
+    float lon_max = res.GetValue<float>(extents + 3, 0), lat_max = res.GetValue<float>(extents + 5, 0), alt_max = res.GetValue<float>(extents + 7, 0);
+    lon_min = res.GetValue<float>(extents + 2, 0);
+    lat_min = res.GetValue<float>(extents + 4, 0);
+    alt_min = std::min(0.0f, res.GetValue<float>(extents + 6, 0));
+    lat_step = resolution / 111.32f;
+    lon_step = resolution / (111.32f * std::cos(glm::radians(0.5f * (lat_min + lat_max))));
+    float bin_seconds = minutes * 60.0f;
+    nx = std::max(1, static_cast<int>(std::ceil((lon_max - lon_min) / lon_step)));
+    ny = std::max(1, static_cast<int>(std::ceil((lat_max - lat_min) / lat_step)));
+    nz = volume ? std::max(1, static_cast<int>(std::ceil((alt_max - alt_min) / alt_resolution))) : 0;
+    nt = std::max(1, static_cast<int>(std::floor(seconds / bin_seconds)) + 1);
+    size_t cells = static_cast<size_t>(nx) * ny;
+    size_t bin_values = cells * (2 + nz);
+    if (static_cast<double>(bin_values) * nt > static_cast<double>(1u << 30))
+    {
+        error = "Grid of " + std::to_string(nx) + "x" + std::to_string(ny) + "x" + std::to_string(nt) + " is too large, use coarser bins";
+        nx = ny = nz = nt = 0;
+        return false;
+    }
+
+    // counting sort of the sources by time bin, so every block of bins below reads one contiguous range
+    std::vector<duckdb::unique_ptr<duckdb::DataChunk>> chunks;
+    while (auto chunk = res.Fetch())
+        chunks.push_back(std::move(chunk));
+    auto bin_of = [&](float time)
+    {
+        return std::clamp(static_cast<int>((time + offset) / bin_seconds), 0, nt - 1);
+    };
+    std::vector<size_t> starts(nt + 1, 0);
+    for (const auto &chunk : chunks)
+    {
+        const float *time = duckdb::FlatVector::GetData<float>(chunk->data[0]);
+        for (size_t row = 0; row < chunk->size(); row++)
+            starts[bin_of(time[row]) + 1]++;
+    }
+    for (int t = 0; t < nt; t++)
+        starts[t + 1] += starts[t];
+    std::vector<Binned> sorted(starts[nt]);
+    std::vector<size_t> next(starts.begin(), starts.end() - 1);
+    for (const auto &chunk : chunks)
+    {
+        const float *time = duckdb::FlatVector::GetData<float>(chunk->data[0]);
+        const float *lon = duckdb::FlatVector::GetData<float>(chunk->data[1]);
+        const float *lat = duckdb::FlatVector::GetData<float>(chunk->data[2]);
+        const float *alt = duckdb::FlatVector::GetData<float>(chunk->data[3]);
+        for (size_t row = 0; row < chunk->size(); row++)
+            sorted[next[bin_of(time[row])]++] = {lon[row], lat[row], alt[row]};
+    }
+    chunks.clear();
+
+    density.assign(cells * nt, 0.0f);
+    max_alt.assign(cells * nt, 0.0f);
+    density_3d.assign(cells * nz * nt, 0.0f);
+
+    // blocks of bins small enough that every thread gets its own partial grid of the block, merged cell by cell afterwards
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    int block = static_cast<int>(std::clamp<size_t>((size_t(256) << 20) / (workers * bin_values * sizeof(float)), 1, nt));
+    std::vector<std::vector<float>> partials(workers);
+    for (int t0 = 0; t0 < nt; t0 += block)
+    {
+        int t1 = std::min(nt, t0 + block);
+        size_t block_cells = cells * (t1 - t0);
+        size_t first = starts[t0], count = starts[t1] - first;
+        Parallel(count, [&](size_t thread, size_t begin, size_t end)
+                 {
+            // partial layout: density, max altitude, then the nz levels of the 3D density, each [t - t0][y][x]
+            std::vector<float> &partial = partials[thread];
+            partial.assign(block_cells * (2 + nz), 0.0f);
+            int t = t0;
+            for (size_t i = first + begin; i < first + end; i++)
+            {
+                while (i >= starts[t + 1])
+                    t++;
+                const Binned &source = sorted[i];
+                int x = std::clamp(static_cast<int>((source.lon - lon_min) / lon_step), 0, nx - 1);
+                int y = std::clamp(static_cast<int>((source.lat - lat_min) / lat_step), 0, ny - 1);
+                size_t cell = (t - t0) * cells + static_cast<size_t>(y) * nx + x;
+                partial[cell] += 1.0f;
+                partial[block_cells + cell] = std::max(partial[block_cells + cell], source.alt);
+                if (nz > 0)
+                {
+                    int z = std::clamp(static_cast<int>((source.alt - alt_min) / alt_resolution), 0, nz - 1);
+                    partial[block_cells * (2 + z) + cell] += 1.0f;
+                }
+            } });
+        size_t used = std::min(workers, std::max<size_t>(1, count));
+        Parallel(block_cells, [&](size_t, size_t begin, size_t end)
+                 {
+            for (size_t w = 0; w < used; w++)
+            {
+                const std::vector<float> &partial = partials[w];
+                if (partial.size() != block_cells * (2 + nz))
+                    continue;
+                for (size_t cell = begin; cell < end; cell++)
+                {
+                    size_t out = t0 * cells + cell;
+                    density[out] += partial[cell];
+                    max_alt[out] = std::max(max_alt[out], partial[block_cells + cell]);
+                    for (int z = 0; z < nz; z++)
+                    {
+                        size_t t = cell / cells, xy = cell % cells;
+                        density_3d[((t0 + t) * nz + z) * cells + xy] += partial[block_cells * (2 + z) + cell];
+                    }
+                }
+            } });
+        for (auto &partial : partials)
+            partial.clear();
+    }
+    return true;
+}
+
+void Grid::Clear()
+{
+    nx = ny = nz = nt = 0;
+    density.clear();
+    max_alt.clear();
+    density_3d.clear();
+    slice = 0;
+    slice_max = 0.0f;
+}
+
+bool Grid::Export(duckdb::Connection &con, const std::string &path, std::string &error) const
+{
+    if (nt == 0)
+    {
+        error = "Nothing gridded yet";
+        return false;
+    }
+    size_t cells = static_cast<size_t>(nx) * ny;
+    if (path.size() > 8 && path.compare(path.size() - 8, 8, ".parquet") == 0)
+    {
+        // one row per non-empty cell, appended in whole chunks and written by duckdb
+        if (nz > 0)
+        {
+            error = "3D source density is only exported as raw float32, save the grid without the .parquet extension";
+            return false;
+        }
+        con.Query("CREATE OR REPLACE TEMPORARY TABLE grid (time TIMESTAMP_NS, lon FLOAT, lat FLOAT, source_density FLOAT, max_altitude FLOAT)");
+        duckdb::vector<duckdb::LogicalType> types = {
+            duckdb::LogicalType::TIMESTAMP_NS,
+            duckdb::LogicalType::FLOAT,
+            duckdb::LogicalType::FLOAT,
+            duckdb::LogicalType::FLOAT,
+            duckdb::LogicalType::FLOAT};
+        duckdb::DataChunk chunk;
+        chunk.Initialize(duckdb::Allocator::DefaultAllocator(), types);
+        {
+            duckdb::Appender appender(con, "grid");
+            size_t row = 0;
+            auto flush = [&]()
+            {
+                chunk.SetCardinality(row);
+                appender.AppendDataChunk(chunk);
+                chunk.Reset();
+                row = 0;
+            };
+            chunk.Reset();
+            for (int t = 0; t < nt; t++)
+                for (int y = 0; y < ny; y++)
+                    for (int x = 0; x < nx; x++)
+                    {
+                        size_t cell = t * cells + static_cast<size_t>(y) * nx + x;
+                        if (density[cell] == 0.0f)
+                            continue;
+                        duckdb::FlatVector::GetData<int64_t>(chunk.data[0])[row] = static_cast<int64_t>(time_origin + t * minutes * 60.0 * 1E9);
+                        duckdb::FlatVector::GetData<float>(chunk.data[1])[row] = lon_min + (x + 0.5f) * lon_step;
+                        duckdb::FlatVector::GetData<float>(chunk.data[2])[row] = lat_min + (y + 0.5f) * lat_step;
+                        duckdb::FlatVector::GetData<float>(chunk.data[3])[row] = density[cell];
+                        duckdb::FlatVector::GetData<float>(chunk.data[4])[row] = max_alt[cell];
+                        if (++row == STANDARD_VECTOR_SIZE)
+                            flush();
+                    }
+            if (row > 0)
+                flush();
+            appender.Close();
+        }
+        std::string quoted;
+        for (char c : path)
+            quoted += c == '\'' ? std::string("''") : std::string(1, c);
+        auto result = con.Query("COPY grid TO '" + quoted + "' (FORMAT PARQUET)");
+        con.Query("DROP TABLE grid");
+        if (result->HasError())
+        {
+            error = result->GetError();
+            return false;
+        }
+        return true;
+    }
+
+    // raw little-endian float32 arrays back to back, described by a json sidecar for numpy.fromfile
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(density.data()), density.size() * sizeof(float));
+    out.write(reinterpret_cast<const char *>(max_alt.data()), max_alt.size() * sizeof(float));
+    out.write(reinterpret_cast<const char *>(density_3d.data()), density_3d.size() * sizeof(float));
+    std::ofstream sidecar(path + ".json");
+    sidecar << "{\n"
+            << "  \"dtype\": \"float32\",\n"
+            << "  \"arrays\": [\"source_density\", \"max_altitude\"" << (nz > 0 ? ", \"source_density_3d\"" : "") << "],\n"
+            << "  \"shape\": {\"t\": " << nt << ", \"z\": " << nz << ", \"y\": " << ny << ", \"x\": " << nx << "},\n"
+            << "  \"time_origin_ns\": " << static_cast<int64_t>(time_origin) << ",\n"
+            << "  \"minutes\": " << minutes << ",\n"
+            << "  \"lon_min\": " << lon_min << ", \"lon_step\": " << lon_step << ",\n"
+            << "  \"lat_min\": " << lat_min << ", \"lat_step\": " << lat_step << ",\n"
+            << "  \"alt_min\": " << alt_min << ", \"alt_step\": " << alt_resolution << "\n"
+            << "}\n";
+    return true;
+}
+
+void Grid::Upload()
+{
+    if (nt == 0)
+        return;
+    if (!texture)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void *)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+    slice = std::clamp(slice, 0, nt - 1);
+    const std::vector<float> &values = product == SourceDensity ? density : max_alt;
+    const float *data = values.data() + static_cast<size_t>(slice) * nx * ny;
+    slice_max = *std::max_element(data, data + static_cast<size_t>(nx) * ny);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, nx, ny, 0, GL_RED, GL_FLOAT, data);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // corners of the mesh as a triangle strip
+    float lon_max = lon_min + nx * lon_step, lat_max = lat_min + ny * lat_step;
+    glm::vec2 corners[4] = {{lon_min, lat_min}, {lon_max, lat_min}, {lon_min, lat_max}, {lon_max, lat_max}};
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,44 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <duckdb.hpp>
+#include <GL/glew.h>
+
+struct Grid // lmatools-style products of the filtered sources on a fixed lon/lat(/alt) mesh in time bins
+{
+    enum Product
+    {
+        SourceDensity,
+        MaxAltitude,
+        ProductCount
+    };
+
+    float resolution = 1.0f;     // km between cells horizontally
+    float alt_resolution = 1.0f; // km between levels of the 3D source density
+    float minutes = 1.0f;        // length of a time bin
+    bool volume = false;         // also grid the 3D source density
+
+    int nx = 0, ny = 0, nz = 0, nt = 0;
+    float lon_min = 0.0f, lat_min = 0.0f, lon_step = 0.0f, lat_step = 0.0f, alt_min = 0.0f;
+    double time_origin = 0.0;            // ns since epoch the first bin starts at, a multiple of the bin length
+    std::vector<float> density, max_alt; // sources and highest source altitude (km) per cell, [t][y][x]
+    std::vector<float> density_3d;       // sources per cell, [t][z][y][x]
+
+    bool show = false; // draw a slice under the sources in lon_lat
+    int product = SourceDensity;
+    int slice = 0;           // time bin shown
+    float slice_max = 0.0f;  // largest value of the shown slice, the top of the color scale
+    std::array<const char *, ProductCount> options = {"Source Density", "Max. Altitude"};
+    GLuint texture = 0, vao = 0, vbo = 0;
+
+    // grids the rows of a filter query, whose float time (s) is relative to the MIN/MAX time, lon, lat, alt columns starting at extents
+    bool Compute(duckdb::MaterializedQueryResult &res, size_t extents, std::string &error);
+    void Clear();                                                                           // drops the products, e.g. when the filter changes under them
+    bool Export(duckdb::Connection &con, const std::string &path, std::string &error) const; // .parquet (non-empty cells, 2D only) or a raw float32 stack with a .json sidecar
+    void Upload();                                                                          // shown slice into the texture, needs a gl context
+};
+
+#endif
@@ -0,0 +1,314 @@
+#include "lylout.h"
+#include <regex>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <bit>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <exception>
+#include <libdeflate.h>
+
+void Sources::Clear()
+{
+    datetime.clear();
+    lat.clear();
+    lon.clear();
+    alt.clear();
+    chi.clear();
+    pdb.clear();
+    number_stations.clear();
+    mask.clear();
+}
+
+void Sources::Move(Sources &other)
+{
+    auto move = [](auto &to, auto &from)
+    {
+        to.insert(to.end(), from.begin(), from.end());
+    };
+    move(datetime, other.datetime);
+    move(lat, other.lat);
+    move(lon, other.lon);
+    move(alt, other.alt);
+    move(chi, other.chi);
+    move(pdb, other.pdb);
+    move(number_stations, other.number_stations);
+    move(mask, other.mask);
+    if (!other.station_order.empty())
+        station_order = other.station_order;
+    other.Clear();
+}
+
+size_t LylParser::Parse(const char *begin, const char *end, Sources &out)
+{
+    const char *line = begin;
+    while (line < end)
+    {
+        const char *newline = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        if (!newline)
+            break; // partial line, picked up again once the rest of it is written
+
+        if (!in_data)
+        {
+            in_data = std::strncmp(line, "*** data ***", 12) == 0;
+            if (std::strncmp(line, "Station mask order:", 19) == 0)
+            {
+                const char *first = line + 19, *last = newline;
+                while (first < last && std::isspace(static_cast<unsigned char>(*first)))
+                    first++;
+                while (last > first && std::isspace(static_cast<unsigned char>(last[-1])))
+                    last--;
+                out.station_order.assign(first, last);
+            }
+        }
+        else
+        {
+            // time (s of day), lat, lon, alt (m), reduced chi^2, power (dBW), station mask
+            char *cursor = const_cast<char *>(line);
+            double seconds = std::strtod(cursor, &cursor);
+            float lat = std::strtof(cursor, &cursor);
+            float lon = std::strtof(cursor, &cursor);
+            float alt = std::strtof(cursor, &cursor);
+            float chi = std::strtof(cursor, &cursor);
+            float pdb = std::strtof(cursor, &cursor);
+            char *mask_begin = cursor;
+            unsigned long mask = std::strtoul(mask_begin, &cursor, 0); // written as hex with a 0x prefix
+            if (cursor != mask_begin && cursor <= newline)
+            {
+                out.datetime.push_back(day_epoch * 1000000000LL + std::llround(seconds * 1E9));
+                out.lat.push_back(lat);
+                out.lon.push_back(lon);
+                out.alt.push_back(alt / 1000.0f);
+                out.chi.push_back(chi);
+                out.pdb.push_back(pdb);
+                out.number_stations.push_back(static_cast<uint8_t>(std::popcount(mask)));
+                out.mask.push_back(static_cast<uint32_t>(mask));
+            }
+        }
+        line = newline + 1;
+    }
+    return line - begin;
+}
+
+bool LylDayEpoch(const std::string &path, int64_t &day_epoch)
+{
+    static const std::regex date_pattern(R"(.*\w+_(\d+)_\d+_\d+\.dat(\.gz)?)");
+    std::smatch match;
+    if (!std::regex_match(path, match, date_pattern))
+        return false;
+
+    std::string yymmdd = match[1].str();
+    std::tm tm = {};
+    tm.tm_year = 2000 + std::stoi(yymmdd.substr(0, 2)) - 1900;
+    tm.tm_mon = std::stoi(yymmdd.substr(2, 2)) - 1;
+    tm.tm_mday = std::stoi(yymmdd.substr(4, 2));
+    day_epoch = static_cast<int64_t>(std::mktime(&tm));
+    return true;
+}
+
+bool IsGzip(const std::string &path)
+{
+    return path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+}
+
+void InflateGzip(const std::string &compressed, std::string &inflated)
+{
+    // libdeflate inflates whole buffers, sized from the ISIZE trailer and grown if that was wrapped or the file has several members
+    struct Decompressor
+    {
+        libdeflate_decompressor *decompressor = libdeflate_alloc_decompressor();
+        ~Decompressor() { libdeflate_free_decompressor(decompressor); }
+    } d;
+    if (!d.decompressor)
+        throw std::runtime_error("could not allocate a gzip decompressor");
+
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(compressed.data());
+    size_t in_size = compressed.size();
+    size_t size_hint = in_size >= 4 ? (in[in_size - 4] | in[in_size - 3] << 8 | in[in_size - 2] << 16 | static_cast<size_t>(in[in_size - 1]) << 24) : 0;
+    inflated.clear();
+    while (in_size > 0)
+    {
+        size_t out_offset = inflated.size();
+        size_t capacity = std::max(size_hint, in_size * 4);
+        libdeflate_result result;
+        size_t in_used = 0, out_used = 0;
+        do
+        {
+            inflated.resize(out_offset + capacity);
+            result = libdeflate_gzip_decompress_ex(d.decompressor, in, in_size, inflated.data() + out_offset, capacity, &in_used, &out_used);
+            capacity *= 2;
+        } while (result == LIBDEFLATE_INSUFFICIENT_SPACE);
+        if (result != LIBDEFLATE_SUCCESS)
+            throw std::runtime_error("corrupt gzip data");
+        inflated.resize(out_offset + out_used);
+        in += in_used;
+        in_size -= in_used;
+        size_hint = 0;
+        if (std::all_of(in, in + in_size, [](unsigned char c)
+                        { return c == 0; }))
+            break; // zero padding after the last member (e.g. from tape or block devices), ignored like gzip -d does
+    }
+}
+
+uint64_t LylFingerprint(const std::string &path, uint64_t &size)
+{
+    // FNV-1a over the first and last 64 KiB, cheap for any file size and the same wherever a copy of the file lives
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream)
+        throw std::runtime_error("could not open " + path);
+    size = static_cast<uint64_t>(stream.tellg());
+    uint64_t hash = 14695981039346656037ull;
+    std::string buffer;
+    auto mix = [&](uint64_t offset, uint64_t length)
+    {
+        buffer.resize(length);
+        stream.seekg(static_cast<std::streamoff>(offset));
+        stream.read(buffer.data(), static_cast<std::streamsize>(length));
+        for (unsigned char c : buffer)
+            hash = (hash ^ c) * 1099511628211ull;
+    };
+    uint64_t span = std::min<uint64_t>(size, 65536);
+    mix(0, span);
+    mix(size - span, span);
+    return hash ^ size;
+}
+
+std::string LylStationOrder(const std::string &path)
+{
+    // the data itself is loaded by duckdb, only the header lines go through the parser
+    std::ifstream stream(path);
+    LylParser parser;
+    Sources header;
+    std::string line;
+    while (!parser.in_data && std::getline(stream, line))
+    {
+        line.push_back('\n');
+        parser.Parse(line.data(), line.data() + line.size(), header);
+    }
+    return header.station_order;
+}
+
+void ParseLylFiles(const std::vector<std::string> &paths, Sources &sources)
+{
+    // every worker takes the next file, inflates it in memory and parses it straight from the inflated buffer
+    std::vector<Sources> parsed(paths.size());
+    std::vector<std::exception_ptr> errors(paths.size());
+    std::atomic<size_t> next = 0;
+    auto work = [&]()
+    {
+        std::string raw, inflated;
+        for (size_t i = next++; i < paths.size(); i = next++)
+        {
+            try
+            {
+                LylParser parser;
+                if (!LylDayEpoch(paths[i], parser.day_epoch))
+                    continue;
+                std::ifstream stream(paths[i], std::ios::binary);
+                if (!stream)
+                    throw std::runtime_error("could not open " + paths[i]);
+                raw.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+                std::string *text = &raw;
+                if (IsGzip(paths[i]))
+                {
+                    InflateGzip(raw, inflated);
+                    text = &inflated;
+                }
+                if (!text->empty() && text->back() != '\n')
+                    text->push_back('\n'); // the parser waits for a newline before taking a line
+                parser.Parse(text->data(), text->data() + text->size(), parsed[i]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+    unsigned int workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), paths.size());
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < workers; i++)
+        threads.emplace_back(work);
+    work();
+    for (auto &thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (errors[i])
+            std::rethrow_exception(errors[i]);
+        sources.Move(parsed[i]);
+    }
+}
+
+void CreateLMA(duckdb::Connection &con)
+{
+    con.Query("CREATE TABLE IF NOT EXISTS lma (datetime TIMESTAMP_NS, lat FLOAT, lon FLOAT, alt FLOAT, chi FLOAT, pdb FLOAT, number_stations UTINYINT, mask UINTEGER)");
+    con.Query("CREATE TABLE IF NOT EXISTS loaded_files (path VARCHAR, size UBIGINT, fingerprint UBIGINT)");
+}
+
+int64_t MergeStagedLMA(duckdb::Connection &con)
+{
+    // only the new rows are sorted, so every load fills row groups of its own narrow time range that zone maps can prune
+    int64_t first_row = con.Query("SELECT COUNT(*) FROM lma")->GetValue<int64_t>(0, 0);
+    auto inserted = con.Query("INSERT INTO lma SELECT * FROM lma_staging ORDER BY datetime");
+    if (inserted->HasError())
+        throw std::runtime_error(inserted->GetError());
+    con.Query("DROP TABLE IF EXISTS lma_staging");
+    IndexLMA(con, first_row);
+    return first_row;
+}
+
+void IndexLMA(duckdb::Connection &con, int64_t first_row)
+{
+    // one row per minute (and per append) with the rowids it spans, appends only add their own minutes
+    con.Query("CREATE TABLE IF NOT EXISTS lma_index (minute BIGINT, first_row BIGINT, last_row BIGINT)");
+    con.Query("INSERT INTO lma_index "
+              "SELECT EPOCH_NS(datetime) // 60000000000 AS minute, MIN(rowid), MAX(rowid) "
+              "FROM lma WHERE rowid >= " +
+              std::to_string(first_row) + " AND datetime IS NOT NULL GROUP BY minute");
+}
+
+void AppendSources(duckdb::Connection &con, const Sources &sources, const std::string &table)
+{
+    // filling whole vectors and appending them as chunks instead of value by value
+    duckdb::vector<duckdb::LogicalType> types = {
+        duckdb::LogicalType::TIMESTAMP_NS,
+        duckdb::LogicalType::FLOAT,
+        duckdb::LogicalType::FLOAT,
+        duckdb::LogicalType::FLOAT,
+        duckdb::LogicalType::FLOAT,
+        duckdb::LogicalType::FLOAT,
+        duckdb::LogicalType::UTINYINT,
+        duckdb::LogicalType::UINTEGER};
+    duckdb::DataChunk chunk;
+    chunk.Initialize(duckdb::Allocator::DefaultAllocator(), types);
+    duckdb::Appender appender(con, table);
+    for (size_t first = 0; first < sources.Size(); first += STANDARD_VECTOR_SIZE)
+    {
+        size_t count = std::min<size_t>(STANDARD_VECTOR_SIZE, sources.Size() - first);
+        chunk.Reset();
+        auto copy = [&](int column, const auto &values)
+        {
+            using T = typename std::decay_t<decltype(values)>::value_type;
+            std::memcpy(duckdb::FlatVector::GetData<T>(chunk.data[column]), values.data() + first, count * sizeof(T));
+        };
+        copy(0, sources.datetime);
+        copy(1, sources.lat);
+        copy(2, sources.lon);
+        copy(3, sources.alt);
+        copy(4, sources.chi);
+        copy(5, sources.pdb);
+        copy(6, sources.number_stations);
+        copy(7, sources.mask);
+        chunk.SetCardinality(count);
+        appender.AppendDataChunk(chunk);
+    }
+    appender.Close();
+}
@@ -0,0 +1,41 @@
+#ifndef LYLOUT_H
+#define LYLOUT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <duckdb.hpp>
+
+struct Sources // parsed LYLOUT rows, one vector per column of the lma table
+{
+    std::vector<int64_t> datetime; // ns since epoch
+    std::vector<float> lat, lon, alt, chi, pdb;
+    std::vector<uint8_t> number_stations;
+    std::vector<uint32_t> mask;    // raw station mask, bit n - 1 - k is station k of station_order
+    std::string station_order;     // station letters from the "Station mask order:" header line
+
+    size_t Size() const { return datetime.size(); }
+    void Clear();
+    void Move(Sources &other); // appends and empties other, taking its station order if it has one
+};
+
+struct LylParser // incremental parser, can be fed a file in arbitrary pieces as it is being written
+{
+    int64_t day_epoch = 0;
+    bool in_data = false; // past the "*** data ***" line that ends the header
+
+    size_t Parse(const char *begin, const char *end, Sources &out); // parses complete lines only, returns the bytes consumed
+};
+
+bool LylDayEpoch(const std::string &path, int64_t &day_epoch);          // seconds since epoch of the day in a LYLOUT_yymmdd_hhmmss_0600.dat(.gz) name
+bool IsGzip(const std::string &path);                                   // ends with .gz
+void InflateGzip(const std::string &compressed, std::string &inflated); // throws on corrupt input
+std::string LylStationOrder(const std::string &path);                   // reads just the header of an uncompressed LYLOUT file
+void ParseLylFiles(const std::vector<std::string> &paths, Sources &sources); // reads, inflates and parses one file per core
+uint64_t LylFingerprint(const std::string &path, uint64_t &size);       // identifies a file by its size and a hash of its head and tail
+void CreateLMA(duckdb::Connection &con);                                // creates the lma and loaded_files tables if they do not exist yet
+int64_t MergeStagedLMA(duckdb::Connection &con);                        // moves lma_staging into lma in datetime order, returns the first new rowid
+void IndexLMA(duckdb::Connection &con, int64_t first_row);              // adds the minute -> rowid range index entries of rows from first_row on
+void AppendSources(duckdb::Connection &con, const Sources &sources, const std::string &table = "lma");
+
+#endif
@@ -4,47 +4,373 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <chrono>
 #include <portable-file-dialogs.h>
 #include <filesystem>
+#include <unordered_set>
+#include <stdexcept>
+#include <tuple>
 #include <duckdb.hpp>
-#include <regex>
 #include <state.h>
+#include <lylout.h>
+#include <tail.h>
 
-duckdb::DuckDB db(nullptr); // in memory databse
-duckdb::Connection con(db); // connection to database
-static State state;         // state of application
+duckdb::DuckDB db(nullptr);   // in memory databse
+duckdb::Connection con(db);   // connection to database
+static State state;           // state of application
+static Tail tail;             // live LYLOUT directory watcher
+static bool show_3d = false;  // 3D view window open
+
+duckdb::unique_ptr<duckdb::MaterializedQueryResult> Run(const std::string &query)
+{
+    // for loading, a failed statement aborts before any file is recorded as loaded
+    auto result = con.Query(query);
+    if (result->HasError())
+        throw std::runtime_error(result->GetError());
+    return result;
+}
+
+std::string Quote(const std::string &text)
+{
+    // sql string literal, file paths may contain quotes
+    std::string quoted = "'";
+    for (char c : text)
+        quoted += c == '\'' ? std::string("''") : std::string(1, c);
+    return quoted + "'";
+}
+
+void SetStationOrder(const std::string &order)
+{
+    // the station filter's bits would mean other stations under a different network's order
+    if (order.empty() || order == state.filter.station_order)
+        return;
+    state.filter.station_order = order;
+    state.filter.required_stations = state.filter.excluded_stations = 0;
+}
+
+std::string TimeWindowRows()
+{
+    // the minute index turns the window into a rowid range, the datetime bounds let duckdb skip row groups by their zone maps
+    if (!state.filter.time_window)
+        return "TRUE";
+    auto first = con.Query("SELECT epoch_ns(MIN(datetime)) FROM lma");
+    if (first->HasError() || first->RowCount() == 0 || first->GetValue(0, 0).IsNull())
+        return "TRUE";
+    int64_t start = first->GetValue<int64_t>(0, 0) + std::llround(state.filter.window_start * 60.0) * 1000000000LL;
+    int64_t end = start + std::llround(state.filter.window_length * 60.0) * 1000000000LL;
+    auto ranges = con.Query("SELECT first_row, last_row FROM lma_index "
+                            "WHERE minute BETWEEN " +
+                            std::to_string(start / 60000000000LL) + " AND " + std::to_string((end - 1) / 60000000000LL) + " ORDER BY first_row");
+    if (ranges->HasError() || ranges->RowCount() == 0)
+        return "FALSE";
+
+    // every load is sorted on its own, so loads overlapping in time give a minute several row ranges; they are kept apart
+    // rather than spanned, merging only touching ones, up to a limit past which one span is cheaper to evaluate
+    constexpr size_t max_ranges = 64;
+    std::vector<std::pair<int64_t, int64_t>> merged;
+    for (size_t row = 0; row < ranges->RowCount(); row++)
+    {
+        int64_t first = ranges->GetValue<int64_t>(0, row), last = ranges->GetValue<int64_t>(1, row);
+        if (!merged.empty() && first <= merged.back().second + 1)
+            merged.back().second = std::max(merged.back().second, last);
+        else
+            merged.push_back({first, last});
+    }
+    if (merged.size() > max_ranges)
+    {
+        int64_t last = merged.back().second;
+        for (const auto &range : merged)
+            last = std::max(last, range.second);
+        merged = {{merged.front().first, last}};
+    }
+    std::string rows;
+    for (const auto &[first, last] : merged)
+        rows += (rows.empty() ? "(" : " OR ") + std::string("rowid BETWEEN ") + std::to_string(first) + " AND " + std::to_string(last);
+    return rows + ") AND datetime >= MAKE_TIMESTAMP_NS(" + std::to_string(start) + ")"
+                  " AND datetime < MAKE_TIMESTAMP_NS(" + std::to_string(end) + ")";
+}
 
 void FilterLMA()
 {
-    std::string filter_query =
-        "WITH filtered AS ("
-        "  SELECT "
-        "    CAST(EPOCH_NS(datetime) AS DOUBLE) AS time, "
-        "    lon, "
-        "    lat, "
-        "    alt "
-        "  FROM lma "
-        "  WHERE number_stations >= " +
-        std::to_string(state.filter.min_stations) +
-        "    AND alt >= " + std::to_string(state.filter.min_alt) +
-        "    AND alt <= " + std::to_string(state.filter.max_alt) +
-        "    AND chi >= " + std::to_string(state.filter.min_chi) +
-        "    AND chi <= " + std::to_string(state.filter.max_chi) +
-        "    AND pdb >= " + std::to_string(state.filter.min_power) +
-        "    AND pdb <= " + std::to_string(state.filter.max_power) +
-        ") "
-        "SELECT "
-        "  CAST(time - MIN(time) OVER () AS FLOAT) AS time, "
-        "  lon, lat, alt, "
-        "  MIN(time) OVER (), MAX(time) OVER (), "
-        "  MIN(lon) OVER (), MAX(lon) OVER (), "
-        "  MIN(lat) OVER (), MAX(lat) OVER (), "
-        "  MIN(alt) OVER (), MAX(alt) OVER () "
-        "FROM filtered";
-    auto result = con.Query(filter_query);
+    state.grid.Clear(); // gridded from the previous filter
+    auto result = con.Query(state.FilterQuery(TimeWindowRows(), "MIN(time) OVER ()"));
     state.Draw(result);
 }
 
+void PlotNewRows(int64_t first_row)
+{
+    // only the new rows are filtered and uploaded, the plots draw them on top of what they already show
+    if (state.graphics.sources == 0)
+    {
+        FilterLMA();
+        return;
+    }
+    char time_origin[32];
+    std::snprintf(time_origin, sizeof(time_origin), "%.1f", state.graphics.time_origin);
+    auto result = con.Query(state.FilterQuery("rowid >= " + std::to_string(first_row) + " AND " + TimeWindowRows(), time_origin));
+    state.Append(result);
+}
+
+void AppendLMA(const Sources &sources)
+{
+    // live batches take the same sorted staging merge as opened files, so their index entries stay narrow
+    CreateLMA(con);
+    Run("CREATE OR REPLACE TEMPORARY TABLE lma_staging AS FROM lma LIMIT 0");
+    AppendSources(con, sources, "lma_staging");
+    PlotNewRows(MergeStagedLMA(con));
+}
+
+void RecordTailed(const std::unordered_map<std::string, uintmax_t> &read)
+{
+    // tailed files are kept in loaded_files like opened ones, refreshed as they grow so the row left once a file is
+    // complete carries the fingerprint an Open of the finished file looks for
+    if (read.empty())
+        return;
+    CreateLMA(con);
+    std::string paths;
+    for (const auto &[path, offset] : read)
+        paths += (paths.empty() ? "" : ", ") + Quote(path);
+    Run("DELETE FROM loaded_files WHERE path IN (" + paths + ")");
+    duckdb::Appender appender(con, "loaded_files");
+    for (const auto &[path, offset] : read)
+    {
+        uint64_t size;
+        uint64_t fingerprint = LylFingerprint(path, size);
+        appender.AppendRow(duckdb::Value(path), duckdb::Value::UBIGINT(offset), duckdb::Value::UBIGINT(size == offset ? fingerprint : 0));
+    }
+    appender.Close();
+}
+
+std::unordered_map<std::string, uintmax_t> LoadedOffsets(const std::string &directory)
+{
+    // how much of each LYLOUT file in directory is already in lma, going live continues from there instead of loading it again
+    std::unordered_map<std::string, uintmax_t> offsets;
+    CreateLMA(con);
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string path = entry.path().string();
+        int64_t day_epoch;
+        if (!entry.is_regular_file(error) || IsGzip(path) || !LylDayEpoch(path, day_epoch))
+            continue;
+        uint64_t size;
+        uint64_t fingerprint = LylFingerprint(path, size);
+        auto loaded = con.Query("SELECT MAX(size) FROM loaded_files WHERE (size = " + std::to_string(size) + " AND fingerprint = " +
+                                std::to_string(fingerprint) + ") OR path = " + Quote(path));
+        if (!loaded->HasError() && loaded->RowCount() > 0 && !loaded->GetValue(0, 0).IsNull())
+            offsets[path] = std::min<uintmax_t>(loaded->GetValue<uint64_t>(0, 0), size);
+    }
+    return offsets;
+}
+
+void AddRotatedText(ImDrawList *draw_list, ImVec2 center, ImU32 color, const char *text, ImVec2 text_size)
+{
+    // lays the label out horizontally once, then turns its vertices 90 degrees counter-clockwise about the center;
+    // glyphs are culled against the clip rect before turning, so the layout is clipped to its own unrotated extent
+    // and the command gets the real clip rect back for the rotated result
+    ImVec2 clip_min = draw_list->GetClipRectMin(), clip_max = draw_list->GetClipRectMax();
+    ImVec2 pos(center.x - text_size.x * 0.5f, center.y - text_size.y * 0.5f);
+    draw_list->PushClipRect(pos, ImVec2(pos.x + text_size.x, pos.y + text_size.y), false);
+    int vtx_begin = draw_list->VtxBuffer.Size;
+    draw_list->AddText(pos, color, text);
+    for (int i = vtx_begin; i < draw_list->VtxBuffer.Size; i++)
+    {
+        ImVec2 &vertex = draw_list->VtxBuffer[i].pos;
+        float dx = vertex.x - center.x;
+        float dy = vertex.y - center.y;
+        vertex = ImVec2(center.x + dy, center.y - dx);
+    }
+    draw_list->CmdBuffer.back().ClipRect = ImVec4(clip_min.x, clip_min.y, clip_max.x, clip_max.y);
+    draw_list->PopClipRect();
+}
+
+struct Brush // box or lasso being dragged on one of the plots
+{
+    State::Plot *plot = nullptr;
+    bool lasso = false;
+    std::vector<ImVec2> points; // screen space
+};
+static Brush brush;
+
+void BrushPlot(State::Plot &plot, ImVec2 top_left, ImDrawList *draw_list)
+{
+    // drag for a box, shift + drag for a lasso, click to clear, called right after the plot's button item
+    const ImU32 color = IM_COL32(255, 255, 255, 255);
+    ImVec2 mouse = ImGui::GetMousePos();
+    if (ImGui::IsItemActivated())
+    {
+        brush.plot = &plot;
+        brush.lasso = ImGui::GetIO().KeyShift;
+        brush.points = {mouse};
+    }
+    if (brush.plot != &plot)
+        return;
+
+    if (ImGui::IsItemActive())
+    {
+        const ImVec2 &last = brush.points.back();
+        if (!brush.lasso)
+            brush.points.resize(1);
+        if (!brush.lasso || std::abs(mouse.x - last.x) + std::abs(mouse.y - last.y) > 2.0f)
+            brush.points.push_back(mouse);
+    }
+    if (brush.points.size() > 1)
+    {
+        if (brush.lasso)
+            draw_list->AddPolyline(brush.points.data(), static_cast<int>(brush.points.size()), color, ImDrawFlags_Closed, 1.0f);
+        else
+            draw_list->AddRect(brush.points.front(), brush.points.back(), color);
+    }
+
+    if (ImGui::IsItemDeactivated())
+    {
+        auto to_data = [&](const ImVec2 &q)
+        {
+            return glm::vec2(plot.x_min + (q.x - top_left.x) / plot.width * (plot.x_max - plot.x_min),
+                             plot.y_max - (q.y - top_left.y) / plot.height * (plot.y_max - plot.y_min));
+        };
+        std::vector<glm::vec2> region;
+        const ImVec2 &a = brush.points.front();
+        const ImVec2 &b = brush.points.back();
+        if (brush.lasso)
+        {
+            for (const ImVec2 &q : brush.points)
+                region.push_back(to_data(q));
+        }
+        else if (std::abs(b.x - a.x) > 2.0f && std::abs(b.y - a.y) > 2.0f)
+        {
+            region = {to_data(a), to_data(ImVec2(b.x, a.y)), to_data(b), to_data(ImVec2(a.x, b.y))};
+        }
+
+        if (region.size() >= 3)
+        {
+            state.Select(plot, region);
+            state.status = "Selected " + std::to_string(state.graphics.selection.count) + " sources";
+        }
+        else
+        {
+            state.ClearSelection();
+        }
+        brush.plot = nullptr;
+        brush.points.clear();
+    }
+}
+
+void PlotPanel(const char *id, State::Plot &plot, const ImVec2 &size)
+{
+    const ImU32 color = IM_COL32(255, 255, 255, 255);
+    float font_size = ImGui::GetFontSize();
+    float axis_size = font_size * 1.8f;
+    float tick_height = font_size * 0.4f;
+    ImGui::BeginChild(id, size, ImGuiChildFlags_Borders);
+    {
+        ImVec2 window_size = ImGui::GetWindowSize();
+        plot.width = static_cast<int>(window_size.x - axis_size);
+        plot.height = static_cast<int>(window_size.y - axis_size);
+
+        // ticks are only recomputed when the extents or the room for labels change
+        plot.x_axis.Layout(plot.x_min, plot.x_max, std::clamp(static_cast<int>(plot.width / (font_size * 5.0f)), 2, 10));
+        plot.y_axis.Layout(plot.y_min, plot.y_max, std::clamp(static_cast<int>(plot.height / (font_size * 3.0f)), 2, 10));
+        for (State::Axis *axis : {&plot.x_axis, &plot.y_axis})
+        {
+            if (axis->label_sizes.size() != axis->labels.size())
+            {
+                axis->label_sizes.clear();
+                for (const auto &label : axis->labels)
+                {
+                    ImVec2 text_size = ImGui::CalcTextSize(label.c_str());
+                    axis->label_sizes.emplace_back(text_size.x, text_size.y);
+                }
+            }
+        }
+
+        ImDrawList *draw_list = ImGui::GetWindowDrawList();
+        ImVec2 p = ImGui::GetCursorScreenPos();
+        ImVec2 origin(p.x + axis_size, p.y + plot.height); // bottom left corner of the plot image
+        ImVec2 top_left(origin.x, p.y);
+        ImVec2 bottom_right(origin.x + plot.width, origin.y);
+        ImGui::SetCursorScreenPos(top_left);
+        ImGui::InvisibleButton("##Brush", ImVec2(static_cast<float>(std::max(plot.width, 1)), static_cast<float>(std::max(plot.height, 1))));
+        draw_list->AddImage((ImTextureID)plot.texture, top_left, bottom_right, ImVec2(0, 0), ImVec2(1, 1));
+        BrushPlot(plot, top_left, draw_list);
+
+        // y axis, labels read bottom to top
+        for (size_t i = 0; i < plot.y_axis.labels.size(); i++)
+        {
+            float y = origin.y - plot.y_axis.positions[i] * plot.height;
+            draw_list->AddLine(ImVec2(origin.x, y), ImVec2(origin.x - tick_height, y), color, 1.0f);
+            const glm::vec2 &text_size = plot.y_axis.label_sizes[i];
+            ImVec2 center(origin.x - tick_height - text_size.y * 0.5f, y);
+            AddRotatedText(draw_list, center, color, plot.y_axis.labels[i].c_str(), ImVec2(text_size.x, text_size.y));
+        }
+
+        // x axis
+        for (size_t i = 0; i < plot.x_axis.labels.size(); i++)
+        {
+            float x = origin.x + plot.x_axis.positions[i] * plot.width;
+            draw_list->AddLine(ImVec2(x, origin.y), ImVec2(x, origin.y + tick_height), color, 1.0f);
+            const glm::vec2 &text_size = plot.x_axis.label_sizes[i];
+            draw_list->AddText(ImVec2(x - text_size.x * 0.5f, origin.y + tick_height), color, plot.x_axis.labels[i].c_str());
+        }
+    }
+    ImGui::EndChild();
+}
+
+void VolumePanel()
+{
+    // orbit camera around the filtered sources, drag to rotate and scroll to zoom
+    State::Graphics::Volume &volume = state.graphics.volume;
+    State::Plot &plot = state.view_3d;
+    ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("3D View", &show_3d))
+    {
+        plot.width = plot.height = 0; // nothing to render while collapsed
+        ImGui::End();
+        return;
+    }
+    float font_size = ImGui::GetFontSize();
+    bool changed = ImGui::Checkbox("Transparent", &volume.transparent);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Blend overlapping sources instead of drawing the nearest.");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(font_size * 8.0f);
+    changed |= ImGui::SliderFloat("Point Size", &volume.point_size, 1.0f, 10.0f, "%.1f");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(font_size * 8.0f);
+    changed |= ImGui::SliderFloat("Vertical Exaggeration", &volume.exaggeration, 1.0f, 10.0f, "%.1f");
+    if (volume.transparent)
+    {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(font_size * 8.0f);
+        changed |= ImGui::SliderFloat("Opacity", &volume.opacity, 0.01f, 1.0f, "%.2f");
+    }
+    ImGui::Text("%zu of %zu chunks in view, %zu occluded", volume.visible_chunks, volume.bounds.size() / 2, volume.occluded_chunks);
+
+    ImVec2 size = ImGui::GetContentRegionAvail();
+    plot.width = std::max(static_cast<int>(size.x), 1);
+    plot.height = std::max(static_cast<int>(size.y), 1);
+    ImVec2 top_left = ImGui::GetCursorScreenPos();
+    ImVec2 bottom_right(top_left.x + plot.width, top_left.y + plot.height);
+    ImGui::InvisibleButton("##Orbit", ImVec2(static_cast<float>(plot.width), static_cast<float>(plot.height)));
+    ImGui::GetWindowDrawList()->AddImage((ImTextureID)plot.texture, top_left, bottom_right, ImVec2(0, 0), ImVec2(1, 1));
+
+    ImGuiIO &io = ImGui::GetIO();
+    if (ImGui::IsItemActive() && (io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f))
+    {
+        volume.yaw -= io.MouseDelta.x * 0.01f;
+        volume.pitch = std::clamp(volume.pitch + io.MouseDelta.y * 0.01f, -1.5f, 1.5f);
+        changed = true;
+    }
+    if (ImGui::IsItemHovered() && io.MouseWheel != 0.0f)
+    {
+        volume.distance = std::clamp(volume.distance * std::pow(0.9f, io.MouseWheel), 0.2f, 20.0f);
+        changed = true;
+    }
+    if (changed)
+        plot.dirty = true;
+    ImGui::End();
+}
+
 void RenderUI()
 {
     // menu bar
@@ -65,33 +391,47 @@ void RenderUI()
                     state.status = "loading files";
                     try
                     {
-                        con.Query("DROP TABLE IF EXISTS lma");
-                        con.Query("CREATE TABLE lma (datetime TIMESTAMP_NS, lat FLOAT, lon FLOAT, alt FLOAT, chi FLOAT, pdb FLOAT, number_stations UTINYINT)");
+                        // loading is additive, new files go through a staging table and files loaded before are skipped
+                        CreateLMA(con);
+                        Run("CREATE OR REPLACE TEMPORARY TABLE lma_staging AS FROM lma LIMIT 0");
 
-                        std::regex date_pattern(R"(.*\w+_(\d+)_\d+_\d+\.dat)");
                         std::unordered_map<int64_t, std::vector<std::string>> files_by_day; // grouping files per day to take advantage of DuckDB multi file reading
+                        std::vector<std::string> compressed;                                // inflated and parsed in parallel, one file per core
+                        std::unordered_set<uint64_t> fingerprints; // also catches the same file selected twice
+                        std::vector<std::tuple<std::string, uint64_t, uint64_t>> loaded; // loaded_files rows, recorded once the rows are in lma
+                        size_t skipped = 0;
                         for (const auto &filepath : selection)
                         {
-                            std::smatch match;
-                            std::string yymmdd;
-
-                            if (std::regex_match(filepath, match, date_pattern))
+                            int64_t day_epoch;
+                            if (!LylDayEpoch(filepath, day_epoch))
+                                continue;
+                            std::error_code error;
+                            if (tail.running && std::filesystem::equivalent(std::filesystem::path(filepath).parent_path(), tail.directory, error))
+                            {
+                                skipped++; // the live tail reads every file of its directory
+                                continue;
+                            }
+                            uint64_t size;
+                            uint64_t fingerprint = LylFingerprint(filepath, size);
+                            std::string match = "size = " + std::to_string(size) + " AND fingerprint = " + std::to_string(fingerprint);
+                            if (!fingerprints.insert(fingerprint).second || Run("SELECT COUNT(*) FROM loaded_files WHERE " + match)->GetValue<int64_t>(0, 0) > 0)
                             {
-                                yymmdd = match[1].str();
-                                int year = 2000 + std::stoi(yymmdd.substr(0, 2));
-                                int month = std::stoi(yymmdd.substr(2, 2));
-                                int day = std::stoi(yymmdd.substr(4, 2));
-                                std::tm tm = {};
-                                tm.tm_year = year - 1900;
-                                tm.tm_mon = month - 1;
-                                tm.tm_mday = day;
-                                tm.tm_hour = 0;
-                                tm.tm_min = 0;
-                                tm.tm_sec = 0;
-                                std::time_t time_t_value = std::mktime(&tm);
-                                int64_t ns_since_epoch = static_cast<int64_t>(time_t_value);
-                                files_by_day[ns_since_epoch].push_back(filepath);
+                                skipped++;
+                                continue;
                             }
+                            loaded.emplace_back(filepath, size, fingerprint);
+                            if (IsGzip(filepath))
+                                compressed.push_back(filepath);
+                            else
+                                files_by_day[day_epoch].push_back(filepath);
+                        }
+
+                        if (!compressed.empty())
+                        {
+                            Sources sources;
+                            ParseLylFiles(compressed, sources);
+                            AppendSources(con, sources, "lma_staging");
+                            SetStationOrder(sources.station_order);
                         }
 
                         for (const auto &[day_epoch, paths] : files_by_day)
@@ -100,15 +440,16 @@ void RenderUI()
 
                             for (size_t i = 0; i < paths.size(); ++i)
                             {
-                                paths_sql += "'" + paths[i] + "'";
+                                paths_sql += Quote(paths[i]);
                                 if (i + 1 < paths.size())
                                     paths_sql += ",";
                             }
 
                             paths_sql += "]";
+                            SetStationOrder(LylStationOrder(paths.front()));
 
-                            con.Query(
-                                "INSERT INTO lma (datetime, lat, lon, alt, chi, pdb, number_stations) "
+                            Run(
+                                "INSERT INTO lma_staging (datetime, lat, lon, alt, chi, pdb, number_stations, mask) "
                                 "SELECT "
                                 "TRY(MAKE_TIMESTAMP_NS(CAST((CAST(arr[1] AS DOUBLE) + " +
                                 std::to_string(day_epoch) + ") * 1E9 AS BIGINT))), "
@@ -117,7 +458,8 @@ void RenderUI()
                                                             "TRY(CAST(arr[4] AS DOUBLE) / 1000), "
                                                             "TRY_CAST(arr[5] AS FLOAT), "
                                                             "TRY_CAST(arr[6] AS FLOAT), "
-                                                            "CAST(bit_count(TRY_CAST(arr[7] AS INTEGER)) AS UTINYINT) "
+                                                            "CAST(bit_count(TRY_CAST(arr[7] AS INTEGER)) AS UTINYINT), "
+                                                            "TRY_CAST(arr[7] AS UINTEGER) "
                                                             "FROM ("
                                                             "SELECT REGEXP_SPLIT_TO_ARRAY(TRIM(column0), ' +') AS arr "
                                                             "FROM read_csv(" +
@@ -125,8 +467,16 @@ void RenderUI()
                                             "new_line='\\n', comment='', columns={'column0':'VARCHAR'}, header=false, skip=53)"
                                             ") t;");
                         }
-                        state.status = "Loaded " + std::to_string(selection.size()) + " files";
-                        FilterLMA();
+                        int64_t first_row = MergeStagedLMA(con);
+                        {
+                            duckdb::Appender appender(con, "loaded_files");
+                            for (const auto &[path, size, fingerprint] : loaded)
+                                appender.AppendRow(duckdb::Value(path), duckdb::Value::UBIGINT(size), duckdb::Value::UBIGINT(fingerprint));
+                            appender.Close();
+                        }
+                        state.status = "Loaded " + std::to_string(loaded.size()) + " files" +
+                                       (skipped ? ", skipped " + std::to_string(skipped) + " already loaded or watched live" : "");
+                        PlotNewRows(first_row);
                     }
                     catch (const std::exception &e)
                     {
@@ -137,6 +487,27 @@ void RenderUI()
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Open LYLOUT files ending with .dat or .dat.gz.");
 
+            if (ImGui::MenuItem(tail.running ? "Stop Live" : "Live"))
+            {
+                if (tail.running)
+                {
+                    tail.Stop();
+                    state.status = "Stopped watching " + tail.directory;
+                }
+                else
+                {
+                    auto directory = pfd::select_folder("Select directory LYLOUT files are written to").result();
+                    if (!directory.empty())
+                    {
+                        tail.Start(directory, LoadedOffsets(directory), []
+                                   { glfwPostEmptyEvent(); });
+                        state.status = "Watching " + directory;
+                    }
+                }
+            }
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Watch a directory and plot LYLOUT sources as they are written.");
+
             if (ImGui::MenuItem("ENTLN/NLDN"))
             {
                 auto selection = pfd::open_file(
@@ -184,6 +555,22 @@ void RenderUI()
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Export data as parquet file with Apache arrow.");
 
+            if (ImGui::MenuItem("Grid"))
+            {
+                auto path = pfd::save_file(
+                                "Save grid",
+                                "grid.parquet",
+                                {"Parquet", "*.parquet", "Raw float32", "*.bin"})
+                                .result();
+                if (!path.empty())
+                {
+                    std::string error;
+                    state.status = state.grid.Export(con, path, error) ? "Saved grid to " + path : error;
+                }
+            }
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Export the gridded products as parquet or as a raw float32 stack.");
+
             if (ImGui::MenuItem("State"))
             {
             }
@@ -201,6 +588,10 @@ void RenderUI()
             if (ImGui::IsItemHovered())
                 ImGui::SetTooltip("Start animation playback.");
 
+            ImGui::MenuItem("3D View", nullptr, &show_3d);
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Show the filtered sources in a rotatable 3D view.");
+
             if (ImGui::MenuItem("Reset"))
             {
             }
@@ -210,6 +601,8 @@ void RenderUI()
             if (ImGui::MenuItem("Clear"))
             {
                 con.Query("DROP TABLE IF EXISTS lma");
+                con.Query("DROP TABLE IF EXISTS lma_index");
+                con.Query("DROP TABLE IF EXISTS loaded_files");
                 con.Query("DROP TABLE IF EXISTS ctg");
                 state.Clear();
             }
@@ -332,286 +725,232 @@ void RenderUI()
     {
         FilterLMA();
     }
-    ImGui::Text("Maps");
-    ImGui::Text("Colors");
-
-    ImGui::Combo("Colormaps", &state.graphics.colormap.index, state.graphics.colormap.options.data(), state.graphics.colormap.options.size()); // not dynamic yet
-    ImGui::Text("Animation");
-    ImGui::EndChild();
 
-    ImGui::SameLine();
+    if (ImGui::Checkbox("Time Window", &state.filter.time_window))
+    {
+        FilterLMA();
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Only plot a window of minutes, reading just the data of those minutes.");
 
-    ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
-    ImGui::BeginChild("##Plots", ImVec2(0, 0), ImGuiChildFlags_Borders);
-    float fixed_plot_height = ImGui::GetContentRegionAvail().y * 0.15f;
-    float fixed_plot_width = ImGui::GetContentRegionAvail().x * 0.8f;
-    float axis_size = ImGui::GetFontSize() * 1.8f;
-    float tick_height = ImGui::GetFontSize() * 0.4f;
-    ImGui::BeginChild("##TimeAltitude", ImVec2(-1, fixed_plot_height), ImGuiChildFlags_Borders);
+    if (state.filter.time_window)
     {
-        ImVec2 window_size = ImGui::GetWindowSize();
-        float width = window_size.x;
-        float height = window_size.y;
-        state.time_alt.width = width - axis_size;
-        state.time_alt.height = height - axis_size;
-        ImGui::BeginChild("##AltAxis1", ImVec2(axis_size, height - axis_size), false);
+        if (ImGui::InputFloat("Window Start (min)", &state.filter.window_start))
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.5f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float y = p.y + tick_positions[i] * state.time_alt.height;
-                float x = p.x + axis_size;
-                draw_list->AddLine(ImVec2(x, y), ImVec2(x - tick_height, y), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.time_alt.y_major_ticks[i].c_str();
-                float char_y = y - ImGui::CalcTextSize(label).x * 0.5f;
-                float char_x = x - tick_height - ImGui::GetFontSize();
-                for (const char *c = label; *c != '\0'; c++)
-                {
-                    char temp[2] = {*c, '\0'};
-                    ImVec2 char_size = ImGui::CalcTextSize(temp);
-                    draw_list->AddText(ImVec2(char_x, char_y), IM_COL32(255, 255, 255, 255), temp);
-                    char_y += char_size.x;
-                }
-            }
+            FilterLMA();
         }
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::Image((ImTextureID)state.time_alt.texture, ImVec2(width - axis_size, height - axis_size), ImVec2(0, 0), ImVec2(1, 1));
-        ImGui::BeginChild("##Node1", ImVec2(axis_size, axis_size), false);
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::BeginChild("##TimeAxis1", ImVec2(width - axis_size, axis_size), false);
+
+        if (ImGui::InputFloat("Window Length (min)", &state.filter.window_length))
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float x = p.x + tick_positions[i] * state.time_alt.width;
-                draw_list->AddLine(ImVec2(x, p.y), ImVec2(x, p.y + tick_height), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.time_alt.x_major_ticks[i].c_str();
-                ImVec2 text_size = ImGui::CalcTextSize(label);
-                draw_list->AddText(ImVec2(x - text_size.x * 0.5f, p.y + tick_height), IM_COL32(255, 255, 255, 255), label);
-            }
+            FilterLMA();
         }
-        ImGui::EndChild();
     }
-    ImGui::EndChild();
-    ImGui::BeginChild("##LongitudeAltitude", ImVec2(fixed_plot_width, fixed_plot_height), ImGuiChildFlags_Borders);
+
+    const std::string &order = state.filter.station_order;
+    if (!order.empty() && order.size() <= 32)
     {
-        ImVec2 window_size = ImGui::GetWindowSize();
-        float width = window_size.x;
-        float height = window_size.y;
-        state.lon_alt.width = width - axis_size;
-        state.lon_alt.height = height - axis_size;
-        ImGui::BeginChild("##AltAxis2", ImVec2(axis_size, height - axis_size), false);
+        ImGui::Text("Stations");
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Click a station to cycle between any, required (+) and excluded (-).");
+        for (size_t k = 0; k < order.size(); k++)
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.5f, 0.9f};
-            for (int i = 0; i < 5; i++)
+            uint32_t bit = 1u << (order.size() - 1 - k);
+            bool required = state.filter.required_stations & bit;
+            bool excluded = state.filter.excluded_stations & bit;
+            std::string label = std::string(required ? "+" : excluded ? "-" : " ") + order[k] + "##station" + std::to_string(k);
+            if (k % 8 != 0)
+                ImGui::SameLine();
+            if (ImGui::Button(label.c_str()))
             {
-                float y = p.y + tick_positions[i] * state.lon_alt.height;
-                float x = p.x + axis_size;
-                draw_list->AddLine(ImVec2(x, y), ImVec2(x - tick_height, y), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.lon_alt.y_major_ticks[i].c_str();
-                float char_y = y - ImGui::CalcTextSize(label).x * 0.5f;
-                float char_x = x - tick_height - ImGui::GetFontSize();
-                for (const char *c = label; *c != '\0'; c++)
+                if (required)
                 {
-                    char temp[2] = {*c, '\0'};
-                    ImVec2 char_size = ImGui::CalcTextSize(temp);
-                    draw_list->AddText(ImVec2(char_x, char_y), IM_COL32(255, 255, 255, 255), temp);
-                    char_y += char_size.x;
+                    state.filter.required_stations &= ~bit;
+                    state.filter.excluded_stations |= bit;
                 }
+                else if (excluded)
+                    state.filter.excluded_stations &= ~bit;
+                else
+                    state.filter.required_stations |= bit;
+                FilterLMA();
             }
         }
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::Image((ImTextureID)state.lon_alt.texture, ImVec2(width - axis_size, height - axis_size), ImVec2(0, 0), ImVec2(1, 1));
-        ImGui::BeginChild("##Node2", ImVec2(axis_size, axis_size), false);
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::BeginChild("##LonAxis2", ImVec2(width - axis_size, axis_size), false);
+    }
+    ImGui::Text("Maps");
+
+    if (ImGui::Button("Add Map Layer"))
+    {
+        auto selection = pfd::open_file(
+                             "Select map file(s)",
+                             "",
+                             {"Map files", "*.geojson *.json *.shp"},
+                             pfd::opt::multiselect)
+                             .result();
+        for (const auto &file : selection)
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
-            for (int i = 0; i < 5; i++)
+            MapLayer layer;
+            std::string error;
+            if (layer.Load(file, error))
             {
-                float x = p.x + tick_positions[i] * state.lon_alt.width;
-                draw_list->AddLine(ImVec2(x, p.y), ImVec2(x, p.y + tick_height), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.lon_alt.x_major_ticks[i].c_str();
-                ImVec2 text_size = ImGui::CalcTextSize(label);
-                draw_list->AddText(ImVec2(x - text_size.x * 0.5f, p.y + tick_height), IM_COL32(255, 255, 255, 255), label);
+                layer.Upload();
+                state.maps.push_back(std::move(layer));
+                state.status = "loaded map " + state.maps.back().name;
             }
+            else
+                state.status = error;
         }
-        ImGui::EndChild();
+        state.lon_lat.dirty = true;
     }
-    ImGui::EndChild();
-    ImGui::SameLine();
-    ImGui::BeginChild("##AltitudeHistogram", ImVec2(-1, fixed_plot_height), ImGuiChildFlags_Borders);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Overlay GeoJSON or shapefile borders and sites (lon/lat) under the sources.");
+
+    for (size_t i = 0; i < state.maps.size(); i++)
     {
-        ImVec2 window_size = ImGui::GetWindowSize();
-        float width = window_size.x;
-        float height = window_size.y;
-        state.alt_hist.width = width - axis_size;
-        state.alt_hist.height = height - axis_size;
-        ImGui::BeginChild("##AltAxis3", ImVec2(axis_size, height - axis_size), false);
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::Checkbox(state.maps[i].name.c_str(), &state.maps[i].visible))
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.5f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float y = p.y + tick_positions[i] * state.alt_hist.height;
-                float x = p.x + axis_size;
-                draw_list->AddLine(ImVec2(x, y), ImVec2(x - tick_height, y), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.alt_hist.y_major_ticks[i].c_str();
-                float char_y = y - ImGui::CalcTextSize(label).x * 0.5f;
-                float char_x = x - tick_height - ImGui::GetFontSize();
-                for (const char *c = label; *c != '\0'; c++)
-                {
-                    char temp[2] = {*c, '\0'};
-                    ImVec2 char_size = ImGui::CalcTextSize(temp);
-                    draw_list->AddText(ImVec2(char_x, char_y), IM_COL32(255, 255, 255, 255), temp);
-                    char_y += char_size.x;
-                }
-            }
+            state.lon_lat.dirty = true;
         }
-        ImGui::EndChild();
         ImGui::SameLine();
-        ImGui::Image((ImTextureID)state.alt_hist.texture, ImVec2(width - axis_size, height - axis_size), ImVec2(0, 0), ImVec2(1, 1));
-        ImGui::BeginChild("##Node3", ImVec2(axis_size, axis_size), false);
-        ImGui::EndChild();
+        if (ImGui::ColorEdit4("##color", &state.maps[i].color.x, ImGuiColorEditFlags_NoInputs))
+        {
+            state.lon_lat.dirty = true;
+        }
         ImGui::SameLine();
-        ImGui::BeginChild("##CountAxis3", ImVec2(width - axis_size, axis_size), false);
+        if (ImGui::Button("Remove"))
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.5f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float x = p.x + tick_positions[i] * state.alt_hist.width;
-                draw_list->AddLine(ImVec2(x, p.y), ImVec2(x, p.y + tick_height), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.alt_hist.x_major_ticks[i].c_str();
-                ImVec2 text_size = ImGui::CalcTextSize(label);
-                draw_list->AddText(ImVec2(x - text_size.x * 0.5f, p.y + tick_height), IM_COL32(255, 255, 255, 255), label);
-            }
+            state.maps[i].Release();
+            state.maps.erase(state.maps.begin() + i);
+            state.lon_lat.dirty = true;
+            ImGui::PopID();
+            break;
         }
-        ImGui::EndChild();
+        ImGui::PopID();
     }
-    ImGui::EndChild();
-    ImGui::BeginChild("##LongitudeLatitude", ImVec2(fixed_plot_width, -1), ImGuiChildFlags_Borders);
+
+    ImGui::Text("Grids");
+
+    ImGui::InputFloat("Resolution (km)", &state.grid.resolution);
+    ImGui::InputFloat("Time Bin (min)", &state.grid.minutes);
+    ImGui::Checkbox("3D Density", &state.grid.volume);
+    if (state.grid.volume)
+        ImGui::InputFloat("Altitude Step (km)", &state.grid.alt_resolution);
+    if (ImGui::Button("Grid Sources") && state.grid.resolution > 0.0f && state.grid.minutes > 0.0f && state.grid.alt_resolution > 0.0f)
     {
-        ImVec2 window_size = ImGui::GetWindowSize();
-        float width = window_size.x;
-        float height = window_size.y;
-        state.lon_lat.width = width - axis_size;
-        state.lon_lat.height = height - axis_size;
-        ImGui::BeginChild("##LatAxis4", ImVec2(axis_size, height - axis_size), false);
+        auto start = std::chrono::steady_clock::now();
+        auto result = con.Query(state.FilterQuery(TimeWindowRows(), "MIN(time) OVER ()"));
+        std::string error;
+        if (state.grid.Compute(*result, State::AttributeCount, error))
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float y = p.y + tick_positions[i] * state.lon_lat.height;
-                float x = p.x + axis_size;
-                draw_list->AddLine(ImVec2(x, y), ImVec2(x - tick_height, y), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.lon_lat.y_major_ticks[i].c_str();
-                float char_y = y - ImGui::CalcTextSize(label).x * 0.5f;
-                float char_x = x - tick_height - ImGui::GetFontSize();
-                for (const char *c = label; *c != '\0'; c++)
-                {
-                    char temp[2] = {*c, '\0'};
-                    ImVec2 char_size = ImGui::CalcTextSize(temp);
-                    draw_list->AddText(ImVec2(char_x, char_y), IM_COL32(255, 255, 255, 255), temp);
-                    char_y += char_size.x;
-                }
-            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            state.status = "Gridded sources into " + std::to_string(state.grid.nx) + "x" + std::to_string(state.grid.ny) + " cells x " +
+                           std::to_string(state.grid.nt) + " bins in " + std::to_string(seconds) + " s";
+            state.grid.Upload();
         }
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::Image((ImTextureID)state.lon_lat.texture, ImVec2(width - axis_size, height - axis_size), ImVec2(0, 0), ImVec2(1, 1));
-        ImGui::BeginChild("##Node4", ImVec2(axis_size, axis_size), false);
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::BeginChild("##LonAxis4", ImVec2(width - axis_size, axis_size), false);
-        {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float x = p.x + tick_positions[i] * state.lon_lat.width;
-                draw_list->AddLine(ImVec2(x, p.y), ImVec2(x, p.y + tick_height), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.lon_lat.x_major_ticks[i].c_str();
-                ImVec2 text_size = ImGui::CalcTextSize(label);
-                draw_list->AddText(ImVec2(x - text_size.x * 0.5f, p.y + tick_height), IM_COL32(255, 255, 255, 255), label);
-            }
-        }
-        ImGui::EndChild();
+        else
+            state.status = error;
+        state.lon_lat.dirty = true;
     }
-    ImGui::EndChild();
-    ImGui::SameLine();
-    ImGui::BeginChild("##AltitudeLatitude", ImVec2(-1, -1), ImGuiChildFlags_Borders);
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Grid the filtered sources into source density and max. altitude per time bin.");
+
+    if (state.grid.nt > 0)
     {
-        ImVec2 window_size = ImGui::GetWindowSize();
-        float width = window_size.x;
-        float height = window_size.y;
-        state.alt_lat.width = width - axis_size;
-        state.alt_lat.height = height - axis_size;
-        ImGui::BeginChild("##LatAxis5", ImVec2(axis_size, height - axis_size), false);
+        if (ImGui::Checkbox("Show Grid", &state.grid.show))
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.3f, 0.5f, 0.7f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float y = p.y + tick_positions[i] * state.alt_lat.height;
-                float x = p.x + axis_size;
-                draw_list->AddLine(ImVec2(x, y), ImVec2(x - tick_height, y), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.alt_lat.y_major_ticks[i].c_str();
-                float char_y = y - ImGui::CalcTextSize(label).x * 0.5f;
-                float char_x = x - tick_height - ImGui::GetFontSize();
-                for (const char *c = label; *c != '\0'; c++)
-                {
-                    char temp[2] = {*c, '\0'};
-                    ImVec2 char_size = ImGui::CalcTextSize(temp);
-                    draw_list->AddText(ImVec2(char_x, char_y), IM_COL32(255, 255, 255, 255), temp);
-                    char_y += char_size.x;
-                }
-            }
+            state.lon_lat.dirty = true;
         }
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::Image((ImTextureID)state.alt_lat.texture, ImVec2(width - axis_size, height - axis_size), ImVec2(0, 0), ImVec2(1, 1));
-        ImGui::BeginChild("##Node5", ImVec2(axis_size, axis_size), false);
-        ImGui::EndChild();
-        ImGui::SameLine();
-        ImGui::BeginChild("##AltAxis5", ImVec2(width - axis_size, axis_size), false);
+        if (ImGui::Combo("Product", &state.grid.product, state.grid.options.data(), state.grid.options.size()))
         {
-            ImDrawList *draw_list = ImGui::GetWindowDrawList();
-            ImVec2 p = ImGui::GetWindowPos();
-            float tick_positions[] = {0.1f, 0.5f, 0.9f};
-            for (int i = 0; i < 5; i++)
-            {
-                float x = p.x + tick_positions[i] * state.alt_lat.width;
-                draw_list->AddLine(ImVec2(x, p.y), ImVec2(x, p.y + tick_height), IM_COL32(255, 255, 255, 255), 1.0f);
-                const char *label = state.alt_lat.x_major_ticks[i].c_str();
-                ImVec2 text_size = ImGui::CalcTextSize(label);
-                draw_list->AddText(ImVec2(x - text_size.x * 0.5f, p.y + tick_height), IM_COL32(255, 255, 255, 255), label);
-            }
+            state.grid.Upload();
+            state.lon_lat.dirty = true;
+        }
+        if (ImGui::SliderInt("Time Slice", &state.grid.slice, 0, state.grid.nt - 1))
+        {
+            state.grid.Upload();
+            state.lon_lat.dirty = true;
+        }
+    }
+
+    ImGui::Text("Colors");
+
+    if (ImGui::Combo("Colormaps", &state.graphics.colormap.index, state.graphics.colormap.options.data(), state.graphics.colormap.options.size()))
+    {
+        state.Invalidate();
+    }
+    if (ImGui::Combo("Color By", &state.graphics.color_by.index, state.graphics.color_by.options.data(), state.graphics.color_by.options.size()))
+    {
+        state.UpdateColors();
+    }
+    if (ImGui::Checkbox("Equalize", &state.graphics.color_by.equalize))
+    {
+        state.UpdateColors();
+    }
+    if (ImGui::IsItemHovered())
+        ImGui::SetTooltip("Spread colors by histogram equalization instead of linearly between min and max.");
+    ImGui::Text("Selection");
+    if (state.graphics.selection.active)
+    {
+        const auto &selection = state.graphics.selection;
+        ImGui::Text("%zu sources", selection.count);
+        if (selection.count > 0)
+        {
+            ImGui::Text("Time: %.3f s to %.3f s (%.3f s)", selection.time_min, selection.time_max, selection.time_max - selection.time_min);
+            ImGui::Text("Altitude p10/p50/p90: %.2f/%.2f/%.2f km", selection.alt_percentiles[0], selection.alt_percentiles[1], selection.alt_percentiles[2]);
         }
-        ImGui::EndChild();
+        if (ImGui::Button("Clear Selection"))
+            state.ClearSelection();
     }
+    else
+    {
+        ImGui::TextDisabled("Drag on a plot to select, shift + drag to lasso.");
+    }
+    ImGui::Text("Animation");
     ImGui::EndChild();
+
+    ImGui::SameLine();
+
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
+    ImGui::BeginChild("##Plots", ImVec2(0, 0), ImGuiChildFlags_Borders);
+    float fixed_plot_height = ImGui::GetContentRegionAvail().y * 0.15f;
+    float fixed_plot_width = ImGui::GetContentRegionAvail().x * 0.8f;
+    PlotPanel("##TimeAltitude", state.time_alt, ImVec2(-1, fixed_plot_height));
+    PlotPanel("##LongitudeAltitude", state.lon_alt, ImVec2(fixed_plot_width, fixed_plot_height));
+    ImGui::SameLine();
+    PlotPanel("##AltitudeHistogram", state.alt_hist, ImVec2(-1, fixed_plot_height));
+    PlotPanel("##LongitudeLatitude", state.lon_lat, ImVec2(fixed_plot_width, -1));
+    ImGui::SameLine();
+    PlotPanel("##AltitudeLatitude", state.alt_lat, ImVec2(-1, -1));
     ImGui::EndChild();
     ImGui::PopStyleVar(2);
     ImGui::End();
+
+    if (show_3d)
+        VolumePanel();
+    else
+        state.view_3d.width = state.view_3d.height = 0;
+}
+
+bool HadInput()
+{
+    ImGuiIO &io = ImGui::GetIO();
+    if (io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f || io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f)
+        return true;
+    if (io.InputQueueCharacters.Size > 0 || ImGui::IsAnyItemActive())
+        return true;
+    for (int button = 0; button < IM_ARRAYSIZE(io.MouseDown); button++)
+        if (io.MouseDown[button])
+            return true;
+    for (int key = ImGuiKey_NamedKey_BEGIN; key < ImGuiKey_NamedKey_END; key++)
+        if (ImGui::IsKeyDown(static_cast<ImGuiKey>(key)))
+            return true;
+
+    static ImVec2 display_size;
+    if (io.DisplaySize.x != display_size.x || io.DisplaySize.y != display_size.y)
+    {
+        display_size = io.DisplaySize;
+        return true;
+    }
+    return false;
 }
 
 #ifdef _WIN32
@@ -665,15 +1004,46 @@ int main()
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
 
+    int busy_frames = 0; // frames to keep polling after input so ImGui can settle hover and animation state
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+        // sleeping until something happens when idle, the timeout still lets tooltips and status text catch up
+        if (busy_frames > 0)
+            glfwPollEvents();
+        else
+            glfwWaitEventsTimeout(0.5);
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        if (HadInput())
+            busy_frames = 3;
+        else if (busy_frames > 0)
+            busy_frames--;
+
+        Sources sources;
+        std::unordered_map<std::string, uintmax_t> read;
+        if (tail.Take(sources, read))
+        {
+            try
+            {
+                if (sources.Size() > 0)
+                {
+                    SetStationOrder(sources.station_order);
+                    AppendLMA(sources);
+                    state.status = "Watching " + tail.directory + ", plotted " + std::to_string(state.graphics.sources) + " sources";
+                }
+                RecordTailed(read);
+            }
+            catch (const std::exception &e)
+            {
+                state.status = "Exception " + std::string(e.what()) + " happened when trying to append live sources.";
+            }
+        }
+
         RenderUI();
+        state.Render();
 
         ImGui::Render();
         int display_w, display_h;
@@ -686,6 +1056,7 @@ int main()
         glfwSwapBuffers(window);
     }
 
+    tail.Stop();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
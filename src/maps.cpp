@@ -0,0 +1,511 @@
+#include "maps.h"
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+    struct Geometry // what the parsers produce before simplification
+    {
+        std::vector<std::vector<glm::vec2>> lines;
+        std::vector<glm::vec2> points;
+    };
+
+    struct Coordinates // nested GeoJSON coordinate arrays
+    {
+        std::vector<double> numbers;
+        std::vector<Coordinates> children;
+    };
+
+    // just enough of a JSON reader to walk a GeoJSON document and pick up every geometry object in it
+    struct GeoJsonReader
+    {
+        const char *p, *end;
+        Geometry &geometry;
+        bool failed = false; // malformed input, every loop stops on it
+
+        void Whitespace()
+        {
+            while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                p++;
+        }
+
+        bool Expect(char c)
+        {
+            Whitespace();
+            if (p < end && *p == c)
+            {
+                p++;
+                return true;
+            }
+            return false;
+        }
+
+        std::string String()
+        {
+            std::string out;
+            if (!Expect('"'))
+            {
+                failed = true;
+                return out;
+            }
+            while (p < end && *p != '"')
+            {
+                if (*p == '\\' && p + 1 < end)
+                    p++;
+                out.push_back(*p++);
+            }
+            if (p >= end)
+                failed = true;
+            p++;
+            return out;
+        }
+
+        void Coords(Coordinates &out)
+        {
+            if (!Expect('['))
+            {
+                failed = true;
+                return;
+            }
+            while (!failed)
+            {
+                Whitespace();
+                if (p >= end)
+                {
+                    failed = true;
+                    return;
+                }
+                if (*p == ']')
+                {
+                    p++;
+                    return;
+                }
+                if (*p == '[')
+                {
+                    out.children.emplace_back();
+                    Coords(out.children.back());
+                }
+                else
+                {
+                    char *next;
+                    out.numbers.push_back(std::strtod(p, &next));
+                    if (next == p)
+                    {
+                        failed = true;
+                        return;
+                    }
+                    p = next;
+                }
+                Expect(',');
+            }
+        }
+
+        void Value()
+        {
+            // every branch consumes input or sets failed, so the loops below always make progress
+            Whitespace();
+            if (p >= end)
+                failed = true;
+            else if (*p == '{')
+                Object();
+            else if (*p == '[')
+            {
+                p++;
+                while (!failed && !Expect(']'))
+                {
+                    Value();
+                    Expect(',');
+                }
+            }
+            else if (*p == '"')
+                String();
+            else
+            {
+                const char *start = p;
+                while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ':')
+                    p++; // number, true, false or null
+                if (p == start)
+                    failed = true;
+            }
+        }
+
+        void Object()
+        {
+            std::string type;
+            Coordinates coordinates;
+            bool has_coordinates = false;
+            p++;
+            while (!failed && !Expect('}'))
+            {
+                std::string key = String();
+                if (!Expect(':'))
+                {
+                    failed = true;
+                    return;
+                }
+                Whitespace();
+                if (key == "type" && p < end && *p == '"')
+                    type = String();
+                else if (key == "coordinates")
+                {
+                    Coords(coordinates);
+                    has_coordinates = true;
+                }
+                else
+                    Value();
+                Expect(',');
+            }
+            if (has_coordinates && !failed)
+                Emit(type, coordinates);
+        }
+
+        static glm::vec2 Point(const Coordinates &c)
+        {
+            return c.numbers.size() >= 2 ? glm::vec2(static_cast<float>(c.numbers[0]), static_cast<float>(c.numbers[1])) : glm::vec2(NAN);
+        }
+
+        void Line(const Coordinates &c)
+        {
+            std::vector<glm::vec2> line;
+            for (const auto &point : c.children)
+                line.push_back(Point(point));
+            if (line.size() >= 2)
+                geometry.lines.push_back(std::move(line));
+        }
+
+        void Emit(const std::string &type, const Coordinates &c)
+        {
+            if (type == "Point")
+                geometry.points.push_back(Point(c));
+            else if (type == "MultiPoint")
+                for (const auto &point : c.children)
+                    geometry.points.push_back(Point(point));
+            else if (type == "LineString")
+                Line(c);
+            else if (type == "MultiLineString" || type == "Polygon")
+                for (const auto &line : c.children)
+                    Line(line);
+            else if (type == "MultiPolygon")
+                for (const auto &polygon : c.children)
+                    for (const auto &ring : polygon.children)
+                        Line(ring);
+        }
+    };
+
+    template <typename T>
+    T Read(const char *data, bool big_endian = false)
+    {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, data, sizeof(T));
+        if (big_endian)
+            std::reverse(bytes, bytes + sizeof(T));
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    bool ParseShapefile(const std::string &data, Geometry &geometry)
+    {
+        // ESRI shapefile main file, coordinates taken as lon/lat (the .prj is not read)
+        if (data.size() < 100 || Read<int32_t>(data.data(), true) != 9994)
+            return false;
+        size_t offset = 100;
+        while (offset + 12 <= data.size())
+        {
+            int32_t words = Read<int32_t>(data.data() + offset + 4, true);
+            if (words < 2)
+                break;
+            size_t length = static_cast<size_t>(words) * 2;
+            const char *record = data.data() + offset + 8;
+            if (length > data.size() - offset - 8)
+                break;
+            offset += 8 + length;
+
+            int32_t type = Read<int32_t>(record);
+            auto point = [&](const char *at)
+            {
+                return glm::vec2(static_cast<float>(Read<double>(at)), static_cast<float>(Read<double>(at + 8)));
+            };
+            switch (type) // Z and M variants share the x/y layout of the plain types, MultiPatch (31) is skipped
+            {
+            case 1:
+            case 11:
+            case 21:
+                if (length >= 20)
+                    geometry.points.push_back(point(record + 4));
+                break;
+            case 8:
+            case 18:
+            case 28:
+            {
+                if (length < 40)
+                    break;
+                int32_t count = Read<int32_t>(record + 36);
+                for (int32_t i = 0; i < count && 40 + 16 * (static_cast<int64_t>(i) + 1) <= static_cast<int64_t>(length); i++)
+                    geometry.points.push_back(point(record + 40 + 16 * i));
+                break;
+            }
+            case 3:
+            case 13:
+            case 23:
+            case 5:
+            case 15:
+            case 25:
+            {
+                if (length < 44)
+                    break;
+                int32_t parts = Read<int32_t>(record + 36);
+                int32_t count = Read<int32_t>(record + 40);
+                if (parts < 0 || count < 0 || 44 + 4 * static_cast<int64_t>(parts) + 16 * static_cast<int64_t>(count) > static_cast<int64_t>(length))
+                    break;
+                const char *points = record + 44 + 4 * parts;
+
+                // part offsets come from the file, one bad range drops the whole record
+                std::vector<int32_t> starts(parts + 1, count);
+                for (int32_t part = 0; part < parts; part++)
+                    starts[part] = Read<int32_t>(record + 44 + 4 * part);
+                bool valid = true;
+                for (int32_t part = 0; part < parts; part++)
+                    valid &= starts[part] >= 0 && starts[part] <= starts[part + 1] && starts[part + 1] <= count;
+                if (!valid)
+                    break;
+                for (int32_t part = 0; part < parts; part++)
+                {
+                    std::vector<glm::vec2> line;
+                    for (int32_t i = starts[part]; i < starts[part + 1]; i++)
+                        line.push_back(point(points + 16 * i));
+                    if (line.size() >= 2)
+                        geometry.lines.push_back(std::move(line));
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        return true;
+    }
+
+    void Simplify(const std::vector<glm::vec2> &line, float tolerance, std::vector<glm::vec2> &out)
+    {
+        // Douglas-Peucker with an explicit stack, keeps the endpoints
+        if (tolerance <= 0.0f || line.size() <= 2)
+        {
+            out.insert(out.end(), line.begin(), line.end());
+            return;
+        }
+        std::vector<bool> keep(line.size(), false);
+        keep.front() = keep.back() = true;
+        std::vector<std::pair<size_t, size_t>> stack = {{0, line.size() - 1}};
+        while (!stack.empty())
+        {
+            auto [first, last] = stack.back();
+            stack.pop_back();
+            glm::vec2 a = line[first], b = line[last];
+            float dx = b.x - a.x, dy = b.y - a.y;
+            float length = std::sqrt(dx * dx + dy * dy);
+            float max_distance = 0.0f;
+            size_t farthest = first;
+            for (size_t i = first + 1; i < last; i++)
+            {
+                float px = line[i].x - a.x, py = line[i].y - a.y;
+                float distance = length > 0.0f ? std::abs(px * dy - py * dx) / length : std::sqrt(px * px + py * py);
+                if (distance > max_distance)
+                {
+                    max_distance = distance;
+                    farthest = i;
+                }
+            }
+            if (max_distance > tolerance)
+            {
+                keep[farthest] = true;
+                stack.push_back({first, farthest});
+                stack.push_back({farthest, last});
+            }
+        }
+        for (size_t i = 0; i < line.size(); i++)
+            if (keep[i])
+                out.push_back(line[i]);
+    }
+
+    constexpr char cache_magic[8] = {'X', 'L', 'M', 'A', 'M', 'A', 'P', '1'};
+
+    struct SourceStamp // identifies the file a cache was built from
+    {
+        uint64_t size;
+        int64_t modified;
+    };
+
+    SourceStamp Stamp(const std::string &file)
+    {
+        std::error_code error;
+        return {static_cast<uint64_t>(std::filesystem::file_size(file, error)),
+                static_cast<int64_t>(std::filesystem::last_write_time(file, error).time_since_epoch().count())};
+    }
+
+    bool ReadCache(const std::string &cache, const SourceStamp &stamp, MapLayer &layer)
+    {
+        // every count is checked against the bytes left, a truncated or corrupt cache just means parsing again
+        std::ifstream cached(cache, std::ios::binary | std::ios::ate);
+        if (!cached)
+            return false;
+        uint64_t remaining = static_cast<uint64_t>(cached.tellg());
+        cached.seekg(0);
+        auto read = [&](void *to, uint64_t bytes)
+        {
+            if (bytes > remaining)
+                return false;
+            cached.read(static_cast<char *>(to), static_cast<std::streamsize>(bytes));
+            remaining -= bytes;
+            return cached.good();
+        };
+        auto in_range = [&](int64_t first, int64_t count)
+        {
+            return first >= 0 && count >= 0 && first + count <= static_cast<int64_t>(layer.vertices.size());
+        };
+
+        char magic[8];
+        SourceStamp cached_stamp;
+        if (!read(magic, sizeof(magic)) || std::memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+            !read(&cached_stamp, sizeof(cached_stamp)) || cached_stamp.size != stamp.size || cached_stamp.modified != stamp.modified)
+            return false;
+        uint64_t vertex_count = 0;
+        if (!read(&vertex_count, sizeof(vertex_count)) || vertex_count > remaining / sizeof(glm::vec2))
+            return false;
+        layer.vertices.resize(vertex_count);
+        if (!read(layer.vertices.data(), vertex_count * sizeof(glm::vec2)))
+            return false;
+        for (int level = 0; level < MapLayer::levels; level++)
+        {
+            uint64_t line_count = 0;
+            if (!read(&line_count, sizeof(line_count)) || line_count > remaining / (sizeof(GLint) + sizeof(GLsizei)))
+                return false;
+            layer.firsts[level].resize(line_count);
+            layer.counts[level].resize(line_count);
+            if (!read(layer.firsts[level].data(), line_count * sizeof(GLint)) || !read(layer.counts[level].data(), line_count * sizeof(GLsizei)))
+                return false;
+            for (uint64_t line = 0; line < line_count; line++)
+                if (!in_range(layer.firsts[level][line], layer.counts[level][line]))
+                    return false;
+        }
+        return read(&layer.point_first, sizeof(layer.point_first)) && read(&layer.point_count, sizeof(layer.point_count)) &&
+               in_range(layer.point_first, layer.point_count);
+    }
+}
+
+bool MapLayer::Load(const std::string &file, std::string &error)
+{
+    path = file;
+    name = std::filesystem::path(file).filename().string();
+    std::string cache = file + ".xlmacache";
+    SourceStamp stamp = Stamp(file);
+
+    // cached layers skip parsing and simplification entirely
+    if (ReadCache(cache, stamp, *this))
+        return true;
+
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream)
+    {
+        error = "could not open " + file;
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    Geometry geometry;
+    std::string extension = std::filesystem::path(file).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".shp")
+    {
+        if (!ParseShapefile(data, geometry))
+        {
+            error = file + " is not a shapefile";
+            return false;
+        }
+    }
+    else
+    {
+        GeoJsonReader reader{data.data(), data.data() + data.size(), geometry};
+        reader.Value();
+        if (reader.failed)
+        {
+            error = file + " is not valid GeoJSON";
+            return false;
+        }
+    }
+
+    vertices.clear();
+    for (int level = 0; level < levels; level++)
+    {
+        firsts[level].clear();
+        counts[level].clear();
+        for (const auto &line : geometry.lines)
+        {
+            GLint first = static_cast<GLint>(vertices.size());
+            Simplify(line, tolerances[level], vertices);
+            firsts[level].push_back(first);
+            counts[level].push_back(static_cast<GLsizei>(vertices.size()) - first);
+        }
+    }
+    point_first = static_cast<GLint>(vertices.size());
+    point_count = static_cast<GLsizei>(geometry.points.size());
+    vertices.insert(vertices.end(), geometry.points.begin(), geometry.points.end());
+
+    std::ofstream out(cache, std::ios::binary);
+    if (out)
+    {
+        uint64_t vertex_count = vertices.size();
+        out.write(cache_magic, sizeof(cache_magic));
+        out.write(reinterpret_cast<const char *>(&stamp), sizeof(stamp));
+        out.write(reinterpret_cast<const char *>(&vertex_count), sizeof(vertex_count));
+        out.write(reinterpret_cast<const char *>(vertices.data()), vertex_count * sizeof(glm::vec2));
+        for (int level = 0; level < levels; level++)
+        {
+            uint64_t line_count = firsts[level].size();
+            out.write(reinterpret_cast<const char *>(&line_count), sizeof(line_count));
+            out.write(reinterpret_cast<const char *>(firsts[level].data()), line_count * sizeof(GLint));
+            out.write(reinterpret_cast<const char *>(counts[level].data()), line_count * sizeof(GLsizei));
+        }
+        out.write(reinterpret_cast<const char *>(&point_first), sizeof(point_first));
+        out.write(reinterpret_cast<const char *>(&point_count), sizeof(point_count));
+    }
+    return true;
+}
+
+int MapLayer::Level(float degrees_per_pixel) const
+{
+    int level = 0;
+    while (level + 1 < levels && tolerances[level + 1] <= degrees_per_pixel)
+        level++;
+    return level;
+}
+
+void MapLayer::Upload()
+{
+    if (!vao)
+    {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+    }
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void *)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MapLayer::Release()
+{
+    if (vao)
+    {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        vao = vbo = 0;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef MAPS_H
+#define MAPS_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+struct MapLayer // borders as line strips and sites as points, in lon/lat
+{
+    static constexpr int levels = 5;
+    static constexpr std::array<float, levels> tolerances = {0.0f, 0.0005f, 0.002f, 0.008f, 0.03f}; // Douglas-Peucker tolerance per level, degrees
+
+    std::string name, path;
+    bool visible = true;
+    glm::vec4 color = glm::vec4(0.6f, 0.6f, 0.6f, 1.0f);
+    std::vector<glm::vec2> vertices;                // every level's simplified lines back to back, then the points
+    std::array<std::vector<GLint>, levels> firsts;  // first vertex of each line strip per level
+    std::array<std::vector<GLsizei>, levels> counts;
+    GLint point_first = 0;
+    GLsizei point_count = 0;
+    GLuint vao = 0, vbo = 0;
+
+    bool Load(const std::string &file, std::string &error); // from the binary cache when it is newer than the file, otherwise parses and writes it
+    int Level(float degrees_per_pixel) const;                // coarsest level whose error stays under a pixel
+    void Upload();                                          // static vbo, needs a gl context
+    void Release();
+};
+
+#endif
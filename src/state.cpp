@@ -4,44 +4,313 @@ void State::InitializeGraphics()
 {
     const char *vert_src = R"(
 #version 330 core
-layout(location = 0) in vec2 position;
-layout(location = 1) in float value;
+layout(location = 0) in float x;
+layout(location = 1) in float y;
+layout(location = 2) in float value;
 uniform mat4 projection;
+uniform vec2 value_range;
+uniform bool equalize;
+uniform sampler2D cdf;
+uniform bool selecting;
+uniform sampler2D selection;
+uniform int mask_width;
 out float vValue;
+flat out int vSelected;
 
 void main() {
-    gl_Position = projection * vec4(position, 0.0, 1.0);
+    gl_Position = projection * vec4(x, y, 0.0, 1.0);
     gl_PointSize = 1.0;
-    vValue = value;
+    float t = clamp((value - value_range.x) / max(value_range.y - value_range.x, 1e-30), 0.0, 1.0);
+    vValue = equalize ? texture(cdf, vec2(t, 0.5)).r : t;
+    vSelected = !selecting || texelFetch(selection, ivec2(gl_VertexID % mask_width, gl_VertexID / mask_width), 0).r > 0.5 ? 1 : 0;
 }
 )";
 
     const char *frag_src = R"(
 #version 330 core
 in float vValue;
+flat in int vSelected;
 out vec4 FragColor;
 uniform sampler2D colormaps;
 uniform int cmap_index;
 
 void main() {
     float y = (float(cmap_index) + 0.5) / 5.0;
-    FragColor = texture(colormaps, vec2(vValue, y));
+    FragColor = vSelected == 1 ? texture(colormaps, vec2(vValue, y)) : vec4(0.3, 0.3, 0.3, 1.0);
     FragColor.a = 1.0;
 }
 )";
 
-    GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vert_shader, 1, &vert_src, nullptr);
-    glCompileShader(vert_shader);
-    GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(frag_shader, 1, &frag_src, nullptr);
-    glCompileShader(frag_shader);
-    graphics.shader_program = glCreateProgram();
-    glAttachShader(graphics.shader_program, vert_shader);
-    glAttachShader(graphics.shader_program, frag_shader);
-    glLinkProgram(graphics.shader_program);
-    glDeleteShader(vert_shader);
-    glDeleteShader(frag_shader);
+    // every source becomes one point on a 1x1 target (blended with GL_MAX) or on its bin of a bins x 1 target (blended additively)
+    const char *reduce_vert_src = R"(
+#version 330 core
+layout(location = 0) in float value;
+uniform int mode;
+uniform vec2 value_range;
+uniform int bins;
+uniform bool masked;
+uniform sampler2D selection;
+uniform int mask_width;
+out float vValue;
+
+void main() {
+    float x = 0.0;
+    if (mode == 1) {
+        float t = clamp((value - value_range.x) / max(value_range.y - value_range.x, 1e-30), 0.0, 1.0);
+        x = (min(floor(t * float(bins)), float(bins - 1)) + 0.5) / float(bins) * 2.0 - 1.0;
+    }
+    gl_Position = vec4(x, 0.0, 0.0, 1.0);
+    if (masked && texelFetch(selection, ivec2(gl_VertexID % mask_width, gl_VertexID / mask_width), 0).r < 0.5)
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0); // clipped, only selected sources count
+    gl_PointSize = 1.0;
+    vValue = value;
+}
+)";
+
+    // the brushed region is rasterized into a plot sized texture, blending 1 - dst so overlapping lasso loops fill even-odd
+    const char *region_vert_src = R"(
+#version 330 core
+layout(location = 0) in vec2 position;
+uniform mat4 projection;
+
+void main() {
+    gl_Position = projection * vec4(position, 0.0, 1.0);
+}
+)";
+
+    const char *region_frag_src = R"(
+#version 330 core
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(1.0);
+}
+)";
+
+    // every source inside the region lights up its own texel of the selection mask
+    const char *select_vert_src = R"(
+#version 330 core
+layout(location = 0) in float x;
+layout(location = 1) in float y;
+uniform mat4 projection;
+uniform sampler2D region;
+uniform int mask_width;
+uniform ivec2 mask_size;
+
+void main() {
+    vec4 ndc = projection * vec4(x, y, 0.0, 1.0);
+    bool inside = all(lessThanEqual(abs(ndc.xy), vec2(1.0))) && texture(region, ndc.xy * 0.5 + 0.5).r > 0.5;
+    vec2 texel = vec2(gl_VertexID % mask_width, gl_VertexID / mask_width) + 0.5;
+    gl_Position = inside ? vec4(texel / vec2(mask_size) * 2.0 - 1.0, 0.0, 1.0) : vec4(2.0, 2.0, 2.0, 1.0);
+    gl_PointSize = 1.0;
+}
+)";
+
+    const char *reduce_frag_src = R"(
+#version 330 core
+in float vValue;
+out vec4 FragColor;
+uniform int mode;
+
+void main() {
+    FragColor = mode == 0 ? vec4(vValue, -vValue, 0.0, 0.0) : vec4(1.0);
+}
+)";
+
+    // map overlays in lon/lat, points get a fixed size
+    const char *map_vert_src = R"(
+#version 330 core
+layout(location = 0) in vec2 position;
+uniform mat4 projection;
+
+void main() {
+    gl_Position = projection * vec4(position, 0.0, 1.0);
+    gl_PointSize = 5.0;
+}
+)";
+
+    const char *map_frag_src = R"(
+#version 330 core
+out vec4 FragColor;
+uniform vec4 color;
+
+void main() {
+    FragColor = color;
+}
+)";
+
+    // a grid slice is one quad over the mesh, log scaled when it counts sources
+    const char *grid_vert_src = R"(
+#version 330 core
+layout(location = 0) in vec2 position;
+uniform mat4 projection;
+uniform vec4 bounds;
+out vec2 vTexCoord;
+
+void main() {
+    gl_Position = projection * vec4(position, 0.0, 1.0);
+    vTexCoord = (position - bounds.xy) / (bounds.zw - bounds.xy);
+}
+)";
+
+    const char *grid_frag_src = R"(
+#version 330 core
+in vec2 vTexCoord;
+out vec4 FragColor;
+uniform sampler2D grid;
+uniform sampler2D colormaps;
+uniform int cmap_index;
+uniform float value_max;
+uniform bool logarithmic;
+
+void main() {
+    float value = texture(grid, vTexCoord).r;
+    if (value <= 0.0)
+        discard;
+    float t = logarithmic ? log(1.0 + value) / log(1.0 + value_max) : value / value_max;
+    FragColor = vec4(texture(colormaps, vec2(clamp(t, 0.0, 1.0), (float(cmap_index) + 0.5) / 5.0)).rgb, 1.0);
+}
+)";
+
+    // the 3D view draws every source as an instanced camera facing quad, the instance attributes read the shared buffers
+    const char *volume_vert_src = R"(
+#version 330 core
+layout(location = 0) in float lon;
+layout(location = 1) in float lat;
+layout(location = 2) in float alt;
+layout(location = 3) in float value;
+uniform mat4 transform;
+uniform vec2 viewport;
+uniform float point_size;
+uniform vec2 value_range;
+uniform bool equalize;
+uniform sampler2D cdf;
+uniform bool selecting;
+uniform sampler2D selection;
+uniform int mask_width;
+uniform int base;
+out float vValue;
+out vec2 vCorner;
+out float vDepth;
+flat out int vSelected;
+
+void main() {
+    vCorner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vec4 clip = transform * vec4(lon, lat, alt, 1.0);
+    clip.xy += vCorner * point_size / viewport * clip.w;
+    gl_Position = clip;
+    vDepth = clip.w;
+    float t = clamp((value - value_range.x) / max(value_range.y - value_range.x, 1e-30), 0.0, 1.0);
+    vValue = equalize ? texture(cdf, vec2(t, 0.5)).r : t;
+    int source = base + gl_InstanceID;
+    vSelected = !selecting || texelFetch(selection, ivec2(source % mask_width, source / mask_width), 0).r > 0.5 ? 1 : 0;
+}
+)";
+
+    // mode 0 is opaque, 1 and 2 are the accumulation and revealage passes of weighted blended transparency
+    const char *volume_frag_src = R"(
+#version 330 core
+in float vValue;
+in vec2 vCorner;
+in float vDepth;
+flat in int vSelected;
+out vec4 FragColor;
+uniform sampler2D colormaps;
+uniform int cmap_index;
+uniform int mode;
+uniform float opacity;
+
+void main() {
+    if (dot(vCorner, vCorner) > 1.0)
+        discard;
+    vec3 color = vSelected == 1 ? texture(colormaps, vec2(vValue, (float(cmap_index) + 0.5) / 5.0)).rgb : vec3(0.3);
+    float weight = clamp(opacity * 10.0 / (1e-5 + pow(vDepth / 5.0, 4.0)), 1e-2, 3e3);
+    if (mode == 0)
+        FragColor = vec4(color, 1.0);
+    else if (mode == 1)
+        FragColor = vec4(color * opacity, opacity) * weight;
+    else
+        FragColor = vec4(opacity);
+}
+)";
+
+    const char *composite_vert_src = R"(
+#version 330 core
+
+void main() {
+    gl_Position = vec4(vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+    const char *composite_frag_src = R"(
+#version 330 core
+out vec4 FragColor;
+uniform sampler2D accum;
+uniform sampler2D reveal;
+
+void main() {
+    vec4 sum = texelFetch(accum, ivec2(gl_FragCoord.xy), 0);
+    float revealage = texelFetch(reveal, ivec2(gl_FragCoord.xy), 0).r;
+    FragColor = vec4(sum.rgb / max(sum.a, 1e-5) * (1.0 - revealage), 1.0);
+}
+)";
+
+    // occlusion query proxy, the 36 vertices of a chunk's bounding box from gl_VertexID,
+    // each corner pushed away from the box's projected middle by a sprite half-size like the volume sprites
+    const char *box_vert_src = R"(
+#version 330 core
+uniform mat4 transform;
+uniform vec3 lo;
+uniform vec3 hi;
+uniform vec2 viewport;
+uniform float point_size;
+const int corners[36] = int[36](0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3, 0, 4, 5, 0, 5, 1,
+                                2, 3, 7, 2, 7, 6, 0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5);
+
+void main() {
+    int corner = corners[gl_VertexID];
+    vec4 clip = transform * vec4(mix(lo, hi, vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1)), 1.0);
+    vec4 middle = transform * vec4((lo + hi) * 0.5, 1.0);
+    vec2 away = step(middle.xy * clip.w, clip.xy * middle.w) * 2.0 - 1.0;
+    clip.xy += away * point_size / viewport * clip.w;
+    gl_Position = clip;
+}
+)";
+
+    const char *box_frag_src = R"(
+#version 330 core
+out vec4 FragColor;
+
+void main() {
+    FragColor = vec4(0.0);
+}
+)";
+
+    auto compile = [](const char *vert, const char *frag)
+    {
+        GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vert_shader, 1, &vert, nullptr);
+        glCompileShader(vert_shader);
+        GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(frag_shader, 1, &frag, nullptr);
+        glCompileShader(frag_shader);
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vert_shader);
+        glAttachShader(program, frag_shader);
+        glLinkProgram(program);
+        glDeleteShader(vert_shader);
+        glDeleteShader(frag_shader);
+        return program;
+    };
+    graphics.shader_program = compile(vert_src, frag_src);
+    graphics.reduction.program = compile(reduce_vert_src, reduce_frag_src);
+    graphics.selection.region_program = compile(region_vert_src, region_frag_src);
+    graphics.selection.program = compile(select_vert_src, region_frag_src);
+    graphics.map_program = compile(map_vert_src, map_frag_src);
+    graphics.grid_program = compile(grid_vert_src, grid_frag_src);
+    graphics.volume.program = compile(volume_vert_src, volume_frag_src);
+    graphics.volume.composite_program = compile(composite_vert_src, composite_frag_src);
+    graphics.volume.box_program = compile(box_vert_src, box_frag_src);
 
     float colormap_data[5][256][3] = {
         {{0.267004f, 0.004874f, 0.329415f}, {0.268510f, 0.009605f, 0.335427f}, {0.269944f, 0.014625f, 0.341379f}, {0.271305f, 0.019942f, 0.347269f}, {0.272594f, 0.025563f, 0.353093f}, {0.273809f, 0.031497f, 0.358853f}, {0.274952f, 0.037752f, 0.364543f}, {0.276022f, 0.044167f, 0.370164f}, {0.277018f, 0.050344f, 0.375715f}, {0.277941f, 0.056324f, 0.381191f}, {0.278791f, 0.062145f, 0.386592f}, {0.279566f, 0.067836f, 0.391917f}, {0.280267f, 0.073417f, 0.397163f}, {0.280894f, 0.078907f, 0.402329f}, {0.281446f, 0.084320f, 0.407414f}, {0.281924f, 0.089666f, 0.412415f}, {0.282327f, 0.094955f, 0.417331f}, {0.282656f, 0.100196f, 0.422160f}, {0.282910f, 0.105393f, 0.426902f}, {0.283091f, 0.110553f, 0.431554f}, {0.283197f, 0.115680f, 0.436115f}, {0.283229f, 0.120777f, 0.440584f}, {0.283187f, 0.125848f, 0.444960f}, {0.283072f, 0.130895f, 0.449241f}, {0.282884f, 0.135920f, 0.453427f}, {0.282623f, 0.140926f, 0.457517f}, {0.282290f, 0.145912f, 0.461510f}, {0.281887f, 0.150881f, 0.465405f}, {0.281412f, 0.155834f, 0.469201f}, {0.280868f, 0.160771f, 0.472899f}, {0.280255f, 0.165693f, 0.476498f}, {0.279574f, 0.170599f, 0.479997f}, {0.278826f, 0.175490f, 0.483397f}, {0.278012f, 0.180367f, 0.486697f}, {0.277134f, 0.185228f, 0.489898f}, {0.276194f, 0.190074f, 0.493001f}, {0.275191f, 0.194905f, 0.496005f}, {0.274128f, 0.199721f, 0.498911f}, {0.273006f, 0.204520f, 0.501721f}, {0.271828f, 0.209303f, 0.504434f}, {0.270595f, 0.214069f, 0.507052f}, {0.269308f, 0.218818f, 0.509577f}, {0.267968f, 0.223549f, 0.512008f}, {0.266580f, 0.228262f, 0.514349f}, {0.265145f, 0.232956f, 0.516599f}, {0.263663f, 0.237631f, 0.518762f}, {0.262138f, 0.242286f, 0.520837f}, {0.260571f, 0.246922f, 0.522828f}, {0.258965f, 0.251537f, 0.524736f}, {0.257322f, 0.256130f, 0.526563f}, {0.255645f, 0.260703f, 0.528312f}, {0.253935f, 0.265254f, 0.529983f}, {0.252194f, 0.269783f, 0.531579f}, {0.250425f, 0.274290f, 0.533103f}, {0.248629f, 0.278775f, 0.534556f}, {0.246811f, 0.283237f, 0.535941f}, {0.244972f, 0.287675f, 0.537260f}, {0.243113f, 0.292092f, 0.538516f}, {0.241237f, 0.296485f, 0.539709f}, {0.239346f, 0.300855f, 0.540844f}, {0.237441f, 0.305202f, 0.541921f}, {0.235526f, 0.309527f, 0.542944f}, {0.233603f, 0.313828f, 0.543914f}, {0.231674f, 0.318106f, 0.544834f}, {0.229739f, 0.322361f, 0.545706f}, {0.227802f, 0.326594f, 0.546532f}, {0.225863f, 0.330805f, 0.547314f}, {0.223925f, 0.334994f, 0.548053f}, {0.221989f, 0.339161f, 0.548752f}, {0.220057f, 0.343307f, 0.549413f}, {0.218130f, 0.347432f, 0.550038f}, {0.216210f, 0.351535f, 0.550627f}, {0.214298f, 0.355619f, 0.551184f}, {0.212395f, 0.359683f, 0.551710f}, {0.210503f, 0.363727f, 0.552206f}, {0.208623f, 0.367752f, 0.552675f}, {0.206756f, 0.371758f, 0.553117f}, {0.204903f, 0.375746f, 0.553533f}, {0.203063f, 0.379716f, 0.553925f}, {0.201239f, 0.383670f, 0.554294f}, {0.199430f, 0.387607f, 0.554642f}, {0.197636f, 0.391528f, 0.554969f}, {0.195860f, 0.395433f, 0.555276f}, {0.194100f, 0.399323f, 0.555565f}, {0.192357f, 0.403199f, 0.555836f}, {0.190631f, 0.407061f, 0.556089f}, {0.188923f, 0.410910f, 0.556326f}, {0.187231f, 0.414746f, 0.556547f}, {0.185556f, 0.418570f, 0.556753f}, {0.183898f, 0.422383f, 0.556944f}, {0.182256f, 0.426184f, 0.557120f}, {0.180629f, 0.429975f, 0.557282f}, {0.179019f, 0.433756f, 0.557430f}, {0.177423f, 0.437527f, 0.557565f}, {0.175841f, 0.441290f, 0.557685f}, {0.174274f, 0.445044f, 0.557792f}, {0.172719f, 0.448791f, 0.557885f}, {0.171176f, 0.452530f, 0.557965f}, {0.169646f, 0.456262f, 0.558030f}, {0.168126f, 0.459988f, 0.558082f}, {0.166617f, 0.463708f, 0.558119f}, {0.165117f, 0.467423f, 0.558141f}, {0.163625f, 0.471133f, 0.558148f}, {0.162142f, 0.474838f, 0.558140f}, {0.160665f, 0.478540f, 0.558115f}, {0.159194f, 0.482237f, 0.558073f}, {0.157729f, 0.485932f, 0.558013f}, {0.156270f, 0.489624f, 0.557936f}, {0.154815f, 0.493313f, 0.557840f}, {0.153364f, 0.497000f, 0.557724f}, {0.151918f, 0.500685f, 0.557587f}, {0.150476f, 0.504369f, 0.557430f}, {0.149039f, 0.508051f, 0.557250f}, {0.147607f, 0.511733f, 0.557049f}, {0.146180f, 0.515413f, 0.556823f}, {0.144759f, 0.519093f, 0.556572f}, {0.143343f, 0.522773f, 0.556295f}, {0.141935f, 0.526453f, 0.555991f}, {0.140536f, 0.530132f, 0.555659f}, {0.139147f, 0.533812f, 0.555298f}, {0.137770f, 0.537492f, 0.554906f}, {0.136408f, 0.541173f, 0.554483f}, {0.135066f, 0.544853f, 0.554029f}, {0.133743f, 0.548535f, 0.553541f}, {0.132444f, 0.552216f, 0.553018f}, {0.131172f, 0.555899f, 0.552459f}, {0.129933f, 0.559582f, 0.551864f}, {0.128729f, 0.563265f, 0.551229f}, {0.127568f, 0.566949f, 0.550556f}, {0.126453f, 0.570633f, 0.549841f}, {0.125394f, 0.574318f, 0.549086f}, {0.124395f, 0.578002f, 0.548287f}, {0.123463f, 0.581687f, 0.547445f}, {0.122606f, 0.585371f, 0.546557f}, {0.121831f, 0.589055f, 0.545623f}, {0.121148f, 0.592739f, 0.544641f}, {0.120565f, 0.596422f, 0.543611f}, {0.120092f, 0.600104f, 0.542530f}, {0.119738f, 0.603785f, 0.541400f}, {0.119512f, 0.607464f, 0.540218f}, {0.119423f, 0.611141f, 0.538982f}, {0.119483f, 0.614817f, 0.537692f}, {0.119699f, 0.618490f, 0.536347f}, {0.120081f, 0.622161f, 0.534946f}, {0.120638f, 0.625828f, 0.533488f}, {0.121380f, 0.629492f, 0.531973f}, {0.122312f, 0.633153f, 0.530398f}, {0.123444f, 0.636809f, 0.528763f}, {0.124780f, 0.640461f, 0.527068f}, {0.126326f, 0.644107f, 0.525311f}, {0.128087f, 0.647749f, 0.523491f}, {0.130067f, 0.651384f, 0.521608f}, {0.132268f, 0.655014f, 0.519661f}, {0.134692f, 0.658636f, 0.517649f}, {0.137339f, 0.662252f, 0.515571f}, {0.140210f, 0.665859f, 0.513427f}, {0.143303f, 0.669459f, 0.511215f}, {0.146616f, 0.673050f, 0.508936f}, {0.150148f, 0.676631f, 0.506589f}, {0.153894f, 0.680203f, 0.504172f}, {0.157851f, 0.683765f, 0.501686f}, {0.162016f, 0.687316f, 0.499129f}, {0.166383f, 0.690856f, 0.496502f}, {0.170948f, 0.694384f, 0.493803f}, {0.175707f, 0.697900f, 0.491033f}, {0.180653f, 0.701402f, 0.488189f}, {0.185783f, 0.704891f, 0.485273f}, {0.191090f, 0.708366f, 0.482284f}, {0.196571f, 0.711827f, 0.479221f}, {0.202219f, 0.715272f, 0.476084f}, {0.208030f, 0.718701f, 0.472873f}, {0.214000f, 0.722114f, 0.469588f}, {0.220124f, 0.725509f, 0.466226f}, {0.226397f, 0.728888f, 0.462789f}, {0.232815f, 0.732247f, 0.459277f}, {0.239374f, 0.735588f, 0.455688f}, {0.246070f, 0.738910f, 0.452024f}, {0.252899f, 0.742211f, 0.448284f}, {0.259857f, 0.745492f, 0.444467f}, {0.266941f, 0.748751f, 0.440573f}, {0.274149f, 0.751988f, 0.436601f}, {0.281477f, 0.755203f, 0.432552f}, {0.288921f, 0.758394f, 0.428426f}, {0.296479f, 0.761561f, 0.424223f}, {0.304148f, 0.764704f, 0.419943f}, {0.311925f, 0.767822f, 0.415586f}, {0.319809f, 0.770914f, 0.411152f}, {0.327796f, 0.773980f, 0.406640f}, {0.335885f, 0.777018f, 0.402049f}, {0.344074f, 0.780029f, 0.397381f}, {0.352360f, 0.783011f, 0.392636f}, {0.360741f, 0.785964f, 0.387814f}, {0.369214f, 0.788888f, 0.382914f}, {0.377779f, 0.791781f, 0.377939f}, {0.386433f, 0.794644f, 0.372886f}, {0.395174f, 0.797475f, 0.367757f}, {0.404001f, 0.800275f, 0.362552f}, {0.412913f, 0.803041f, 0.357269f}, {0.421908f, 0.805774f, 0.351910f}, {0.430983f, 0.808473f, 0.346476f}, {0.440137f, 0.811138f, 0.340967f}, {0.449368f, 0.813768f, 0.335384f}, {0.458674f, 0.816363f, 0.329727f}, {0.468053f, 0.818921f, 0.323998f}, {0.477504f, 0.821444f, 0.318195f}, {0.487026f, 0.823929f, 0.312321f}, {0.496615f, 0.826376f, 0.306377f}, {0.506271f, 0.828786f, 0.300362f}, {0.515992f, 0.831158f, 0.294279f}, {0.525776f, 0.833491f, 0.288127f}, {0.535621f, 0.835785f, 0.281908f}, {0.545524f, 0.838039f, 0.275626f}, {0.555484f, 0.840254f, 0.269281f}, {0.565498f, 0.842430f, 0.262877f}, {0.575563f, 0.844566f, 0.256415f}, {0.585678f, 0.846661f, 0.249897f}, {0.595839f, 0.848717f, 0.243329f}, {0.606045f, 0.850733f, 0.236712f}, {0.616293f, 0.852709f, 0.230052f}, {0.626579f, 0.854645f, 0.223353f}, {0.636902f, 0.856542f, 0.216620f}, {0.647257f, 0.858400f, 0.209861f}, {0.657642f, 0.860219f, 0.203082f}, {0.668054f, 0.861999f, 0.196293f}, {0.678489f, 0.863742f, 0.189503f}, {0.688944f, 0.865448f, 0.182725f}, {0.699415f, 0.867117f, 0.175971f}, {0.709898f, 0.868751f, 0.169257f}, {0.720391f, 0.870350f, 0.162603f}, {0.730889f, 0.871916f, 0.156029f}, {0.741388f, 0.873449f, 0.149561f}, {0.751884f, 0.874951f, 0.143228f}, {0.762373f, 0.876424f, 0.137064f}, {0.772852f, 0.877868f, 0.131109f}, {0.783315f, 0.879285f, 0.125405f}, {0.793760f, 0.880678f, 0.120005f}, {0.804182f, 0.882046f, 0.114965f}, {0.814576f, 0.883393f, 0.110347f}, {0.824940f, 0.884720f, 0.106217f}, {0.835270f, 0.886029f, 0.102646f}, {0.845561f, 0.887322f, 0.099702f}, {0.855810f, 0.888601f, 0.097452f}, {0.866013f, 0.889868f, 0.095953f}, {0.876168f, 0.891125f, 0.095250f}, {0.886271f, 0.892374f, 0.095374f}, {0.896320f, 0.893616f, 0.096335f}, {0.906311f, 0.894855f, 0.098125f}, {0.916242f, 0.896091f, 0.100717f}, {0.926106f, 0.897330f, 0.104071f}, {0.935904f, 0.898570f, 0.108131f}, {0.945636f, 0.899815f, 0.112838f}, {0.955300f, 0.901065f, 0.118128f}, {0.964894f, 0.902323f, 0.123941f}, {0.974417f, 0.903590f, 0.130215f}, {0.983868f, 0.904867f, 0.136897f}, {0.993248f, 0.906157f, 0.143936f}},
@@ -58,119 +327,529 @@ void main() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    auto setup = [](Plot &plot_type)
+    glGenTextures(1, &graphics.color_by.cdf);
+    glBindTexture(GL_TEXTURE_2D, graphics.color_by.cdf);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, Graphics::Reduction::bins, 1, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // reduction targets
+    auto target = [](GLuint &texture, GLint format, int width)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, 1, 0, format == GL_RG32F ? GL_RG : GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    };
+    target(graphics.reduction.minmax, GL_RG32F, 1);
+    target(graphics.reduction.histogram, GL_R32F, Graphics::Reduction::bins);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &graphics.reduction.fbo);
+    glGenVertexArrays(1, &graphics.reduction.vao);
+
+    // selection mask (allocated along with the attribute buffers) and brushed region
+    for (GLuint *texture : {&graphics.selection.mask, &graphics.selection.region})
+    {
+        glGenTextures(1, texture);
+        glBindTexture(GL_TEXTURE_2D, *texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &graphics.selection.fbo);
+    glGenVertexArrays(1, &graphics.selection.region_vao);
+    glGenBuffers(1, &graphics.selection.region_vbo);
+    glBindVertexArray(graphics.selection.region_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, graphics.selection.region_vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void *)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(AttributeCount, graphics.attributes.data());
+
+    auto setup = [&](Plot &plot_type, Attribute x, Attribute y)
     {
-        glGenTextures(1, &plot_type.texture);
+        glGenTextures(1, &plot_type.texture); // storage is allocated by Render once the panel size is known
         glBindTexture(GL_TEXTURE_2D, plot_type.texture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, plot_type.width, plot_type.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glGenFramebuffers(1, &plot_type.fbo);
         glBindFramebuffer(GL_FRAMEBUFFER, plot_type.fbo);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, plot_type.texture, 0);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the plots share the attribute buffers, each one only picks which of them are its x and y
         glGenVertexArrays(1, &plot_type.vao);
-        glGenBuffers(1, &plot_type.vbo);
         glBindVertexArray(plot_type.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, plot_type.vbo);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+        glBindBuffer(GL_ARRAY_BUFFER, graphics.attributes[x]);
+        glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)0);
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)(2 * sizeof(float)));
+        glBindBuffer(GL_ARRAY_BUFFER, graphics.attributes[y]);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)0);
         glEnableVertexAttribArray(1);
         glBindVertexArray(0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
     };
 
-    setup(time_alt);
-    setup(lon_alt);
-    setup(alt_hist);
-    setup(lon_lat);
-    setup(alt_lat);
+    setup(time_alt, Time, Altitude);
+    setup(lon_alt, Longitude, Altitude);
+    setup(alt_hist, Altitude, Altitude); // no points drawn yet, the histogram is still to come
+    setup(lon_lat, Longitude, Latitude);
+    setup(alt_lat, Altitude, Latitude);
+
+    // one instance per source, Render3D points the attributes at the first source of every visible run of chunks
+    Graphics::Volume &volume = graphics.volume;
+    setup(view_3d, Longitude, Latitude);
+    glBindVertexArray(view_3d.vao);
+    for (GLuint location = 0; location < 4; location++)
+    {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glBindVertexArray(0);
+    glGenRenderbuffers(1, &volume.depth);
+    glGenFramebuffers(1, &volume.oit_fbo);
+    for (GLuint *texture : {&volume.accum, &volume.reveal})
+    {
+        glGenTextures(1, texture);
+        glBindTexture(GL_TEXTURE_2D, *texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenVertexArrays(1, &volume.empty_vao);
 
     graphics.initialized = true;
 }
 
+std::string State::FilterQuery(const std::string &rows, const std::string &time_origin) const
+{
+    // rows narrows the scan (e.g. to freshly appended rowids), time_origin is what the float time column is relative to
+    return "WITH filtered AS ("
+           "  SELECT "
+           "    CAST(EPOCH_NS(datetime) AS DOUBLE) AS time, "
+           "    lon, "
+           "    lat, "
+           "    alt, "
+           "    pdb, "
+           "    chi, "
+           "    CAST(number_stations AS FLOAT) AS number_stations "
+           "  FROM lma "
+           "  WHERE " +
+           rows +
+           "    AND number_stations >= " + std::to_string(filter.min_stations) +
+           "    AND alt >= " + std::to_string(filter.min_alt) +
+           "    AND alt <= " + std::to_string(filter.max_alt) +
+           "    AND chi >= " + std::to_string(filter.min_chi) +
+           "    AND chi <= " + std::to_string(filter.max_chi) +
+           "    AND pdb >= " + std::to_string(filter.min_power) +
+           "    AND pdb <= " + std::to_string(filter.max_power) +
+           // plain bitwise predicates on the raw mask, vectorized by duckdb like the range checks above
+           (filter.required_stations ? "    AND (mask & " + std::to_string(filter.required_stations) + ") = " + std::to_string(filter.required_stations) : "") +
+           (filter.excluded_stations ? "    AND (mask & " + std::to_string(filter.excluded_stations) + ") = 0" : "") +
+           ") "
+           "SELECT "
+           "  CAST((time - " +
+           time_origin + ") * 1E-9 AS FLOAT) AS time, "
+                         "  lon, lat, alt, pdb, chi, number_stations, "
+                         "  MIN(time) OVER (), MAX(time) OVER (), "
+                         "  MIN(lon) OVER (), MAX(lon) OVER (), "
+                         "  MIN(lat) OVER (), MAX(lat) OVER (), "
+                         "  MIN(alt) OVER (), MAX(alt) OVER () "
+                         "FROM filtered";
+}
+
 void State::Draw(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &res)
+{
+    ClearSelection(); // the mask is indexed by source, which a new filter reorders
+    graphics.sources = 0;
+    graphics.time_origin = res->RowCount() > 0 ? res->GetValue<double>(AttributeCount, 0) : 0.0;
+    Append(res);
+    if (graphics.sources == 0)
+    {
+        time_alt.count = lon_alt.count = lon_lat.count = alt_lat.count = view_3d.count = 0;
+        graphics.volume.bounds.clear();
+        Invalidate();
+        status = "Nothing to plot with current selection";
+    }
+}
+
+void State::Append(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &res)
 {
     // initializing opengl stuff
     if (!graphics.initialized)
         InitializeGraphics();
 
-    std::vector<float> time_alt_data, lon_alt_data, lon_lat_data, alt_lat_data;
-    graphics.sources = res->RowCount();
-    time_alt_data.reserve(graphics.sources * 3);
-    lon_alt_data.reserve(graphics.sources * 3);
-    lon_lat_data.reserve(graphics.sources * 3);
-    alt_lat_data.reserve(graphics.sources * 3);
-    time_alt.x_min = 0; // min hardcoded to 0 since we do relative to minimum to allow for float for epoch_ns
-    time_alt.x_max = res->GetValue<float>(5, 0) - res->GetValue<float>(4, 0);
-    time_alt.y_min = lon_alt.y_min = alt_hist.y_min = alt_lat.x_min = res->GetValue<float>(10, 0);
-    time_alt.y_max = lon_alt.y_max = alt_hist.y_max = alt_lat.x_max = res->GetValue<float>(11, 0);
-    lon_alt.x_min = lon_lat.x_min = res->GetValue<float>(6, 0);
-    lon_alt.x_max = lon_lat.x_max = res->GetValue<float>(7, 0);
-    alt_lat.y_min = lon_lat.y_min = res->GetValue<float>(8, 0);
-    alt_lat.y_max = lon_lat.y_max = res->GetValue<float>(9, 0);
-    for (int i = 0; i < 5; i++)
-    {
-        float t = 0.1f + i * 0.2f;
-        time_alt.x_major_ticks[i] = std::to_string(time_alt.x_min + t * (time_alt.x_max - time_alt.x_min));
-        lon_alt.x_major_ticks[i] = std::to_string(lon_alt.x_min + t * (lon_alt.x_max - lon_alt.x_min));
-        lon_lat.x_major_ticks[i] = std::to_string(lon_lat.x_min + t * (lon_lat.x_max - lon_lat.x_min));
-        lon_lat.y_major_ticks[i] = std::to_string(lon_lat.y_min + t * (lon_lat.y_max - lon_lat.y_min));
-        alt_lat.y_major_ticks[i] = std::to_string(alt_lat.y_min + t * (alt_lat.y_max - alt_lat.y_min));
-    }
-    for (int i = 0; i < 3; i++)
-    {
-        float t = 0.1f + i * 0.4f;
-        time_alt.y_major_ticks[i] = std::to_string(time_alt.y_min + t * (time_alt.y_max - time_alt.y_min));
-        lon_alt.y_major_ticks[i] = std::to_string(lon_alt.y_min + t * (lon_alt.y_max - lon_alt.y_min));
-        alt_hist.y_major_ticks[i] = std::to_string(alt_hist.y_min + t * (alt_hist.y_max - alt_hist.y_min));
-        alt_lat.x_major_ticks[i] = std::to_string(alt_lat.x_min + t * (alt_lat.x_max - alt_lat.x_min));
-    }
-
-    if (graphics.sources > 0)
-    {
-        while (auto chunk = res->Fetch())
+    size_t first = graphics.sources;
+    size_t added = res->RowCount();
+    if (added == 0)
+        return;
+    Reserve(first + added);
+
+    // time is relative to the origin of the first draw so it fits in a float, the extents grow with every append
+    auto merge = [first](float &lo, float &hi, float new_lo, float new_hi)
+    {
+        float old_lo = lo, old_hi = hi;
+        lo = first == 0 ? new_lo : std::min(lo, new_lo);
+        hi = first == 0 ? new_hi : std::max(hi, new_hi);
+        return lo != old_lo || hi != old_hi;
+    };
+    bool extents_changed = first == 0;
+    extents_changed |= merge(time_alt.x_min, time_alt.x_max,
+                             static_cast<float>((res->GetValue<double>(AttributeCount, 0) - graphics.time_origin) * 1E-9),
+                             static_cast<float>((res->GetValue<double>(AttributeCount + 1, 0) - graphics.time_origin) * 1E-9));
+    extents_changed |= merge(lon_lat.x_min, lon_lat.x_max, res->GetValue<float>(AttributeCount + 2, 0), res->GetValue<float>(AttributeCount + 3, 0));
+    extents_changed |= merge(lon_lat.y_min, lon_lat.y_max, res->GetValue<float>(AttributeCount + 4, 0), res->GetValue<float>(AttributeCount + 5, 0));
+    extents_changed |= merge(alt_lat.x_min, alt_lat.x_max, res->GetValue<float>(AttributeCount + 6, 0), res->GetValue<float>(AttributeCount + 7, 0));
+    lon_alt.x_min = lon_lat.x_min;
+    lon_alt.x_max = lon_lat.x_max;
+    alt_lat.y_min = lon_lat.y_min;
+    alt_lat.y_max = lon_lat.y_max;
+    time_alt.y_min = lon_alt.y_min = alt_hist.y_min = alt_lat.x_min;
+    time_alt.y_max = lon_alt.y_max = alt_hist.y_max = alt_lat.x_max;
+
+    // the result columns are already float arrays, so every chunk goes straight into its buffer without interleaving
+    std::vector<glm::vec3> &bounds = graphics.volume.bounds;
+    bounds.resize(2 * ((first + added + Graphics::Volume::chunk - 1) / Graphics::Volume::chunk));
+    for (size_t i = 2 * (first / Graphics::Volume::chunk); i < bounds.size(); i += 2)
+    {
+        if (first % Graphics::Volume::chunk == 0 || i != 2 * (first / Graphics::Volume::chunk))
+        {
+            bounds[i] = glm::vec3(FLT_MAX);
+            bounds[i + 1] = glm::vec3(-FLT_MAX);
+        }
+    }
+    GLintptr offset = first * sizeof(float);
+    size_t source = first;
+    while (auto chunk = res->Fetch())
+    {
+        GLsizeiptr chunk_size = chunk->size() * sizeof(float);
+        for (int attribute = 0; attribute < AttributeCount; attribute++)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, graphics.attributes[attribute]);
+            glBufferSubData(GL_ARRAY_BUFFER, offset, chunk_size, duckdb::FlatVector::GetData<float>(chunk->data[attribute]));
+        }
+        offset += chunk_size;
+
+        // bounding boxes of the 3D view's culling chunks, grown while the rows are still on the cpu
+        const float *lon = duckdb::FlatVector::GetData<float>(chunk->data[Longitude]);
+        const float *lat = duckdb::FlatVector::GetData<float>(chunk->data[Latitude]);
+        const float *alt = duckdb::FlatVector::GetData<float>(chunk->data[Altitude]);
+        for (size_t row = 0; row < chunk->size(); row++, source++)
         {
-            auto &time_vec = chunk->data[0];
-            auto &lon_vec = chunk->data[1];
-            auto &lat_vec = chunk->data[2];
-            auto &alt_vec = chunk->data[3];
-            float *time_data = duckdb::FlatVector::GetData<float>(time_vec);
-            float *lon_data = duckdb::FlatVector::GetData<float>(lon_vec);
-            float *lat_data = duckdb::FlatVector::GetData<float>(lat_vec);
-            float *alt_data = duckdb::FlatVector::GetData<float>(alt_vec);
-            size_t row_count = chunk->size();
-            for (size_t i = 0; i < row_count; i++)
+            size_t box = 2 * (source / Graphics::Volume::chunk);
+            glm::vec3 position(lon[row], lat[row], alt[row]);
+            bounds[box] = glm::min(bounds[box], position);
+            bounds[box + 1] = glm::max(bounds[box + 1], position);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    graphics.sources += added;
+    time_alt.count = lon_alt.count = lon_lat.count = alt_lat.count = view_3d.count = static_cast<GLsizei>(graphics.sources);
+    UpdateColors(first);
+    if (extents_changed)
+        Invalidate();
+
+    status = "Plotted " + std::to_string(graphics.sources) + " sources with " + graphics.colormap.options[graphics.colormap.index] + " colormap";
+}
+
+void State::Reserve(size_t sources)
+{
+    if (sources <= graphics.capacity)
+        return;
+
+    // growing geometrically and in place, so the vaos keep pointing at the same buffer names
+    size_t capacity = std::max(sources, graphics.capacity * 2);
+    GLsizeiptr used = graphics.sources * sizeof(float);
+    GLuint scratch = 0;
+    if (used > 0)
+        glGenBuffers(1, &scratch);
+    for (GLuint buffer : graphics.attributes)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        if (used > 0)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+            glBufferData(GL_COPY_WRITE_BUFFER, used, NULL, GL_STREAM_COPY);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+        }
+        glBufferData(GL_COPY_READ_BUFFER, capacity * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+        if (used > 0)
+            glCopyBufferSubData(GL_COPY_WRITE_BUFFER, GL_COPY_READ_BUFFER, 0, 0, used);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (scratch)
+        glDeleteBuffers(1, &scratch);
+    graphics.capacity = capacity;
+
+    // one mask texel per source, reallocating drops the selection
+    Graphics::Selection &selection = graphics.selection;
+    int rows = static_cast<int>((capacity + Graphics::Selection::width - 1) / Graphics::Selection::width);
+    if (rows > selection.rows)
+    {
+        glBindTexture(GL_TEXTURE_2D, selection.mask);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, Graphics::Selection::width, rows, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        selection.rows = rows;
+        ClearSelection();
+    }
+}
+
+void State::UpdateColors(size_t first)
+{
+    if (!graphics.initialized)
+        return;
+
+    Graphics::ColorBy &color_by = graphics.color_by;
+    GLuint buffer = graphics.attributes[color_by.attributes[color_by.index]];
+
+    // switching attributes only re-points the color input of each plot
+    for (Plot *plot_type : {&time_alt, &lon_alt, &alt_hist, &lon_lat, &alt_lat})
+    {
+        glBindVertexArray(plot_type->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)0);
+        glEnableVertexAttribArray(2);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    bool range_changed = false;
+    if (graphics.sources > first)
+    {
+        glm::vec2 range = ReduceRange(buffer, first, false);
+        float old_min = color_by.min, old_max = color_by.max;
+        color_by.min = first == 0 ? range.x : std::min(color_by.min, range.x);
+        color_by.max = first == 0 ? range.y : std::max(color_by.max, range.y);
+        range_changed = color_by.min != old_min || color_by.max != old_max;
+
+        // appended sources move every bin of the cdf, so the histogram is always taken over all sources
+        if (color_by.equalize)
+        {
+            range_changed = true;
+            std::array<double, Graphics::Reduction::bins> histogram;
+            ReduceHistogram(buffer, glm::vec2(color_by.min, color_by.max), false, histogram);
+
+            // only the 256 bin prefix sum happens on the cpu
+            double total = 0.0;
+            for (double &bin : histogram)
             {
-                const float lon = lon_data[i];
-                const float lat = lat_data[i];
-                const float alt = alt_data[i];
-                const float time = time_data[i];
-                const float color = time / time_alt.x_max;
-                time_alt_data.push_back(time);
-                time_alt_data.push_back(alt);
-                time_alt_data.push_back(color);
-                lon_alt_data.push_back(lon);
-                lon_alt_data.push_back(alt);
-                lon_alt_data.push_back(color);
-                lon_lat_data.push_back(lon);
-                lon_lat_data.push_back(lat);
-                lon_lat_data.push_back(color);
-                alt_lat_data.push_back(alt);
-                alt_lat_data.push_back(lat);
-                alt_lat_data.push_back(color);
+                total += bin;
+                bin = total;
             }
+            std::array<float, Graphics::Reduction::bins> cdf;
+            for (int bin = 0; bin < Graphics::Reduction::bins; bin++)
+                cdf[bin] = static_cast<float>(histogram[bin] / std::max(total, 1.0));
+            glBindTexture(GL_TEXTURE_2D, color_by.cdf);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Graphics::Reduction::bins, 1, GL_RED, GL_FLOAT, cdf.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
         }
+    }
+
+    // appends that keep the range only need their own sources drawn on top of what is already in the fbos
+    if (first == 0 || range_changed)
+        Invalidate();
+}
+
+glm::vec2 State::ReduceRange(GLuint buffer, size_t first, bool masked)
+{
+    // min and max in one pass on a 1x1 target blended with GL_MAX, the max of -value is the min
+    Graphics::Reduction &reduction = graphics.reduction;
+    BeginReduction(buffer, masked);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, reduction.minmax, 0);
+    glViewport(0, 0, 1, 1);
+    glClearColor(-FLT_MAX, -FLT_MAX, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBlendEquation(GL_MAX);
+    glUniform1i(glGetUniformLocation(reduction.program, "mode"), 0);
+    glDrawArrays(GL_POINTS, static_cast<GLint>(first), static_cast<GLsizei>(graphics.sources - first));
+    float minmax[4];
+    glReadPixels(0, 0, 1, 1, GL_RGBA, GL_FLOAT, minmax);
+    EndReduction();
+    return glm::vec2(-minmax[1], minmax[0]);
+}
 
-        auto render = [&](Plot &plot_type, const std::vector<float> &data)
+void State::ReduceHistogram(GLuint buffer, glm::vec2 range, bool masked, std::array<double, Graphics::Reduction::bins> &histogram)
+{
+    // every source adds 1 to the texel of its bin, in batches of at most 2^24 sources because a float texel stops counting
+    // exactly past that, the batches are summed on the cpu
+    constexpr size_t batch = size_t(1) << 24;
+    Graphics::Reduction &reduction = graphics.reduction;
+    BeginReduction(buffer, masked);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, reduction.histogram, 0);
+    glViewport(0, 0, Graphics::Reduction::bins, 1);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glBlendEquation(GL_FUNC_ADD);
+    glUniform1i(glGetUniformLocation(reduction.program, "mode"), 1);
+    glUniform2f(glGetUniformLocation(reduction.program, "value_range"), range.x, range.y);
+    histogram.fill(0.0);
+    std::array<float, Graphics::Reduction::bins> partial;
+    for (size_t first = 0; first < graphics.sources; first += batch)
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDrawArrays(GL_POINTS, static_cast<GLint>(first), static_cast<GLsizei>(std::min(batch, graphics.sources - first)));
+        glReadPixels(0, 0, Graphics::Reduction::bins, 1, GL_RED, GL_FLOAT, partial.data());
+        for (int bin = 0; bin < Graphics::Reduction::bins; bin++)
+            histogram[bin] += partial[bin];
+    }
+    EndReduction();
+}
+
+void State::BeginReduction(GLuint buffer, bool masked)
+{
+    Graphics::Reduction &reduction = graphics.reduction;
+    glBindVertexArray(reduction.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(reduction.program);
+    glUniform1i(glGetUniformLocation(reduction.program, "bins"), Graphics::Reduction::bins);
+    glUniform1i(glGetUniformLocation(reduction.program, "masked"), masked);
+    glUniform1i(glGetUniformLocation(reduction.program, "mask_width"), Graphics::Selection::width);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, graphics.selection.mask);
+    glUniform1i(glGetUniformLocation(reduction.program, "selection"), 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, reduction.fbo);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+}
+
+void State::EndReduction()
+{
+    glBlendEquation(GL_FUNC_ADD);
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+}
+
+void State::Select(Plot &plot_type, const std::vector<glm::vec2> &region)
+{
+    Graphics::Selection &selection = graphics.selection;
+    if (!graphics.initialized || graphics.sources == 0 || region.size() < 3 || plot_type.count == 0)
+    {
+        ClearSelection();
+        return;
+    }
+    glm::mat4 proj = glm::ortho(plot_type.x_min, plot_type.x_max, plot_type.y_max, plot_type.y_min, -1.0f, 1.0f);
+
+    // rasterizing the region at the resolution of the plot it was drawn on
+    glBindTexture(GL_TEXTURE_2D, selection.region);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, plot_type.width, plot_type.height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    glBindFramebuffer(GL_FRAMEBUFFER, selection.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, selection.region, 0);
+    glViewport(0, 0, plot_type.width, plot_type.height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE_MINUS_DST_COLOR, GL_ZERO);
+    glUseProgram(selection.region_program);
+    glUniformMatrix4fv(glGetUniformLocation(selection.region_program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+    glBindBuffer(GL_ARRAY_BUFFER, selection.region_vbo);
+    glBufferData(GL_ARRAY_BUFFER, region.size() * sizeof(glm::vec2), region.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(selection.region_vao);
+    glDrawArrays(GL_TRIANGLE_FAN, 0, static_cast<GLsizei>(region.size()));
+    glDisable(GL_BLEND);
+
+    // testing every source of the plot against the region into the mask
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, selection.mask, 0);
+    glViewport(0, 0, Graphics::Selection::width, selection.rows);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(selection.program);
+    glUniformMatrix4fv(glGetUniformLocation(selection.program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform1i(glGetUniformLocation(selection.program, "mask_width"), Graphics::Selection::width);
+    glUniform2i(glGetUniformLocation(selection.program, "mask_size"), Graphics::Selection::width, selection.rows);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, selection.region);
+    glUniform1i(glGetUniformLocation(selection.program, "region"), 0);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glBindVertexArray(plot_type.vao);
+    glDrawArrays(GL_POINTS, 0, plot_type.count);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    selection.active = true;
+
+    // summary of the selected sources, reduced from the mask without going back to duckdb
+    glm::vec2 time_range = ReduceRange(graphics.attributes[Time], 0, true);
+    glm::vec2 alt_range = ReduceRange(graphics.attributes[Altitude], 0, true);
+    std::array<double, Graphics::Reduction::bins> histogram;
+    ReduceHistogram(graphics.attributes[Altitude], alt_range, true, histogram);
+    double total = 0.0;
+    for (double bin : histogram)
+        total += bin;
+    selection.count = static_cast<size_t>(std::llround(total));
+    selection.time_min = time_range.x;
+    selection.time_max = time_range.y;
+    const std::array<double, 3> quantiles = {0.1, 0.5, 0.9};
+    double cumulative = 0.0;
+    size_t next = 0;
+    for (int bin = 0; bin < Graphics::Reduction::bins && next < quantiles.size(); bin++)
+    {
+        cumulative += histogram[bin];
+        while (next < quantiles.size() && cumulative >= quantiles[next] * total)
+            selection.alt_percentiles[next++] = alt_range.x + (bin + 0.5f) / Graphics::Reduction::bins * (alt_range.y - alt_range.x);
+    }
+
+    Invalidate();
+}
+
+void State::ClearSelection()
+{
+    if (graphics.selection.active)
+        Invalidate();
+    graphics.selection.active = false;
+    graphics.selection.count = 0;
+}
+
+void State::Render()
+{
+    if (!graphics.initialized)
+        return;
+
+    auto render = [&](Plot &plot_type)
+    {
+        if (plot_type.width <= 0 || plot_type.height <= 0)
+            return;
+        if (plot_type.width != plot_type.texture_width || plot_type.height != plot_type.texture_height)
+        {
+            // reallocating in place keeps the texture name the ui is already pointing at
+            glBindTexture(GL_TEXTURE_2D, plot_type.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, plot_type.width, plot_type.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            plot_type.texture_width = plot_type.width;
+            plot_type.texture_height = plot_type.height;
+            plot_type.dirty = true;
+        }
+        if (!plot_type.dirty && plot_type.drawn == plot_type.count)
+            return;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, plot_type.fbo);
+        glViewport(0, 0, plot_type.width, plot_type.height);
+        if (plot_type.dirty)
         {
-            glBindBuffer(GL_ARRAY_BUFFER, plot_type.vbo);
-            glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-            glBindFramebuffer(GL_FRAMEBUFFER, plot_type.fbo);
-            glViewport(0, 0, plot_type.width, plot_type.height);
             glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT);
+            plot_type.drawn = 0;
+            if (&plot_type == &lon_lat)
+            {
+                DrawGrid(plot_type);
+                DrawMaps(plot_type);
+            }
+        }
+        if (plot_type.count > plot_type.drawn)
+        {
             glUseProgram(graphics.shader_program);
             glEnable(GL_PROGRAM_POINT_SIZE);
             glm::mat4 proj = glm::ortho(plot_type.x_min, plot_type.x_max, plot_type.y_max, plot_type.y_min, -1.0f, 1.0f);
@@ -179,27 +858,391 @@ void State::Draw(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &res)
             glBindTexture(GL_TEXTURE_2D, graphics.colormap.texture);
             glUniform1i(glGetUniformLocation(graphics.shader_program, "colormaps"), 0);
             glUniform1i(glGetUniformLocation(graphics.shader_program, "cmap_index"), graphics.colormap.index);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, graphics.color_by.cdf);
+            glUniform1i(glGetUniformLocation(graphics.shader_program, "cdf"), 1);
+            glUniform1i(glGetUniformLocation(graphics.shader_program, "equalize"), graphics.color_by.equalize);
+            glUniform2f(glGetUniformLocation(graphics.shader_program, "value_range"), graphics.color_by.min, graphics.color_by.max);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, graphics.selection.mask);
+            glUniform1i(glGetUniformLocation(graphics.shader_program, "selection"), 2);
+            glUniform1i(glGetUniformLocation(graphics.shader_program, "selecting"), graphics.selection.active);
+            glUniform1i(glGetUniformLocation(graphics.shader_program, "mask_width"), Graphics::Selection::width);
+            glActiveTexture(GL_TEXTURE0);
             glBindVertexArray(plot_type.vao);
-            glDrawArrays(GL_POINTS, 0, graphics.sources);
+            glDrawArrays(GL_POINTS, plot_type.drawn, plot_type.count - plot_type.drawn);
             glBindVertexArray(0);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        };
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        plot_type.drawn = plot_type.count;
+        plot_type.dirty = false;
+    };
 
-        render(time_alt, time_alt_data);
-        render(lon_alt, lon_alt_data);
-        render(lon_lat, lon_lat_data);
-        render(alt_lat, alt_lat_data);
+    render(time_alt);
+    render(lon_alt);
+    render(alt_hist);
+    render(lon_lat);
+    render(alt_lat);
+    Render3D();
+}
 
-        status = "Plotted " + std::to_string(graphics.sources) + " sources with " + graphics.colormap.options[graphics.colormap.index] + " colormap";
+void State::DrawGrid(Plot &plot_type)
+{
+    if (!grid.show || !grid.texture || grid.slice_max <= 0.0f)
+        return;
+    glm::mat4 proj = glm::ortho(plot_type.x_min, plot_type.x_max, plot_type.y_max, plot_type.y_min, -1.0f, 1.0f);
+    glUseProgram(graphics.grid_program);
+    glUniformMatrix4fv(glGetUniformLocation(graphics.grid_program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform4f(glGetUniformLocation(graphics.grid_program, "bounds"), grid.lon_min, grid.lat_min,
+                grid.lon_min + grid.nx * grid.lon_step, grid.lat_min + grid.ny * grid.lat_step);
+    glUniform1f(glGetUniformLocation(graphics.grid_program, "value_max"), grid.slice_max);
+    glUniform1i(glGetUniformLocation(graphics.grid_program, "logarithmic"), grid.product == Grid::SourceDensity);
+    glUniform1i(glGetUniformLocation(graphics.grid_program, "cmap_index"), graphics.colormap.index);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, graphics.colormap.texture);
+    glUniform1i(glGetUniformLocation(graphics.grid_program, "colormaps"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, grid.texture);
+    glUniform1i(glGetUniformLocation(graphics.grid_program, "grid"), 1);
+    glBindVertexArray(grid.vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void State::DrawMaps(Plot &plot_type)
+{
+    // maps go in first so the sources are drawn over them, and only on full redraws since they never change
+    glm::mat4 proj = glm::ortho(plot_type.x_min, plot_type.x_max, plot_type.y_max, plot_type.y_min, -1.0f, 1.0f);
+    float degrees_per_pixel = std::max((plot_type.x_max - plot_type.x_min) / plot_type.width, (plot_type.y_max - plot_type.y_min) / plot_type.height);
+    glUseProgram(graphics.map_program);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glUniformMatrix4fv(glGetUniformLocation(graphics.map_program, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+    for (const auto &map : maps)
+    {
+        if (!map.visible || !map.vao)
+            continue;
+        int level = map.Level(degrees_per_pixel);
+        glUniform4fv(glGetUniformLocation(graphics.map_program, "color"), 1, glm::value_ptr(map.color));
+        glBindVertexArray(map.vao);
+        if (!map.firsts[level].empty())
+            glMultiDrawArrays(GL_LINE_STRIP, map.firsts[level].data(), map.counts[level].data(), static_cast<GLsizei>(map.firsts[level].size()));
+        if (map.point_count > 0)
+            glDrawArrays(GL_POINTS, map.point_first, map.point_count);
+    }
+    glBindVertexArray(0);
+}
+
+glm::mat4 State::VolumeTransform() const
+{
+    // sources in km around the middle of their extents, scaled so the largest half extent is 1, seen by a camera orbiting the origin
+    const Graphics::Volume &volume = graphics.volume;
+    glm::vec3 lo(lon_lat.x_min, lon_lat.y_min, alt_lat.x_min), hi(lon_lat.x_max, lon_lat.y_max, alt_lat.x_max);
+    glm::vec3 center = 0.5f * (lo + hi);
+    glm::vec3 km(111.32f * std::cos(glm::radians(center.y)), 111.32f, volume.exaggeration);
+    glm::vec3 half = 0.5f * (hi - lo) * km;
+    float radius = std::max({half.x, half.y, half.z, 1e-3f});
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), km / radius) * glm::translate(glm::mat4(1.0f), -center);
+    glm::vec3 eye = volume.distance * glm::vec3(std::cos(volume.pitch) * std::cos(volume.yaw), std::cos(volume.pitch) * std::sin(volume.yaw), std::sin(volume.pitch));
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    float aspect = static_cast<float>(std::max(view_3d.width, 1)) / static_cast<float>(std::max(view_3d.height, 1));
+    // flipped vertically like the 2D projections, the panel shows the fbo texture top down
+    glm::mat4 projection = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, -1.0f, 1.0f)) * glm::perspective(glm::radians(45.0f), aspect, 0.01f, 100.0f);
+    return projection * view * model;
+}
+
+void State::Render3D()
+{
+    Graphics::Volume &volume = graphics.volume;
+    Plot &plot_type = view_3d;
+    if (!graphics.initialized || plot_type.width <= 0 || plot_type.height <= 0)
+        return;
+    if (plot_type.width != plot_type.texture_width || plot_type.height != plot_type.texture_height)
+    {
+        glBindTexture(GL_TEXTURE_2D, plot_type.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, plot_type.width, plot_type.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, volume.accum);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, plot_type.width, plot_type.height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, volume.reveal);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, plot_type.width, plot_type.height, 0, GL_RED, GL_FLOAT, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindRenderbuffer(GL_RENDERBUFFER, volume.depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, plot_type.width, plot_type.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, plot_type.fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, volume.depth);
+        plot_type.texture_width = plot_type.width;
+        plot_type.texture_height = plot_type.height;
+        plot_type.dirty = true;
+    }
+    // the last opaque render's query results are read once the newest is available, results become available in issue order
+    if (volume.queried > 0)
+    {
+        GLuint available = 0;
+        glGetQueryObjectuiv(volume.queries[volume.queried - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            volume.occluded_chunks = 0;
+            for (size_t i = 0; i < volume.queried; i++)
+            {
+                GLuint visible = 0;
+                glGetQueryObjectuiv(volume.queries[i], GL_QUERY_RESULT, &visible);
+                volume.occluded_chunks += !visible;
+            }
+            volume.queried = 0;
+        }
+    }
+    if (!plot_type.dirty && plot_type.drawn == plot_type.count)
+        return;
+
+    // a chunk is culled when all eight corners of its box are outside the same clip plane, visible neighbours are drawn as one run
+    struct Chunk
+    {
+        size_t box, first, last;
+        float depth;    // nearest corner, for front to back order
+        bool near_cut; // box crosses the near plane, its proxy would be clipped so it is never occlusion tested
+    };
+    glm::mat4 transform = VolumeTransform();
+    // sprites reach a half-size past their source, so the side planes move out by as much
+    glm::vec3 pad(1.0f + volume.point_size / static_cast<float>(plot_type.width), 1.0f + volume.point_size / static_cast<float>(plot_type.height), 1.0f);
+    std::vector<Chunk> chunks;
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t box = 0; box * 2 < volume.bounds.size(); box++)
+    {
+        const glm::vec3 &lo = volume.bounds[box * 2], &hi = volume.bounds[box * 2 + 1];
+        int outside[6] = {};
+        float depth = FLT_MAX;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec4 clip = transform * glm::vec4(corner & 1 ? hi.x : lo.x, corner & 2 ? hi.y : lo.y, corner & 4 ? hi.z : lo.z, 1.0f);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                outside[axis * 2] += clip[axis] < -clip.w * pad[axis];
+                outside[axis * 2 + 1] += clip[axis] > clip.w * pad[axis];
+            }
+            depth = std::min(depth, clip.w);
+        }
+        if (std::any_of(outside, outside + 6, [](int corners) { return corners == 8; }))
+            continue;
+        size_t first = box * Graphics::Volume::chunk;
+        size_t last = std::min(first + Graphics::Volume::chunk, static_cast<size_t>(plot_type.count));
+        if (last <= first)
+            continue;
+        chunks.push_back({box, first, last, depth, outside[4] > 0});
+        if (!runs.empty() && runs.back().second == first)
+            runs.back().second = last;
+        else
+            runs.push_back({first, last});
+    }
+    volume.visible_chunks = chunks.size();
+
+    GLuint program = volume.program;
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "transform"), 1, GL_FALSE, glm::value_ptr(transform));
+    glUniform2f(glGetUniformLocation(program, "viewport"), static_cast<float>(plot_type.width), static_cast<float>(plot_type.height));
+    glUniform1f(glGetUniformLocation(program, "point_size"), volume.point_size);
+    glUniform1f(glGetUniformLocation(program, "opacity"), volume.opacity);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, graphics.colormap.texture);
+    glUniform1i(glGetUniformLocation(program, "colormaps"), 0);
+    glUniform1i(glGetUniformLocation(program, "cmap_index"), graphics.colormap.index);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, graphics.color_by.cdf);
+    glUniform1i(glGetUniformLocation(program, "cdf"), 1);
+    glUniform1i(glGetUniformLocation(program, "equalize"), graphics.color_by.equalize);
+    glUniform2f(glGetUniformLocation(program, "value_range"), graphics.color_by.min, graphics.color_by.max);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, graphics.selection.mask);
+    glUniform1i(glGetUniformLocation(program, "selection"), 2);
+    glUniform1i(glGetUniformLocation(program, "selecting"), graphics.selection.active);
+    glUniform1i(glGetUniformLocation(program, "mask_width"), Graphics::Selection::width);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLuint color = graphics.attributes[graphics.color_by.attributes[graphics.color_by.index]];
+    auto draw_run = [&](size_t first, size_t last)
+    {
+        // without base instances (gl 4.2) every run re-points the instance attributes at its first source
+        GLuint buffers[4] = {graphics.attributes[Longitude], graphics.attributes[Latitude], graphics.attributes[Altitude], color};
+        for (GLuint location = 0; location < 4; location++)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[location]);
+            glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)(first * sizeof(float)));
+        }
+        glUniform1i(glGetUniformLocation(program, "base"), static_cast<GLint>(first));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(last - first));
+    };
+    auto draw = [&](int mode)
+    {
+        glUniform1i(glGetUniformLocation(program, "mode"), mode);
+        glBindVertexArray(plot_type.vao);
+        for (const auto &[first, last] : runs)
+            draw_run(first, last);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    };
+
+    if (!volume.transparent)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, plot_type.fbo);
+        glViewport(0, 0, plot_type.width, plot_type.height);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_DEPTH_TEST);
+
+        // the nearest chunks are drawn first and fill the depth buffer, the boxes of the rest are tested against it in one batch
+        // and each chunk is skipped if its box had no visible sample, a result that is not ready yet draws the chunk anyway
+        std::sort(chunks.begin(), chunks.end(), [](const Chunk &a, const Chunk &b) { return a.depth < b.depth; });
+        std::vector<const Chunk *> tested;
+        glUniform1i(glGetUniformLocation(program, "mode"), 0);
+        glBindVertexArray(plot_type.vao);
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            if (i < Graphics::Volume::occluders || chunks[i].near_cut)
+                draw_run(chunks[i].first, chunks[i].last);
+            else
+                tested.push_back(&chunks[i]);
+        }
+        if (!tested.empty())
+        {
+            if (volume.queries.size() < tested.size())
+            {
+                size_t old_size = volume.queries.size();
+                volume.queries.resize(tested.size());
+                glGenQueries(static_cast<GLsizei>(tested.size() - old_size), volume.queries.data() + old_size);
+            }
+            glUseProgram(volume.box_program);
+            glUniformMatrix4fv(glGetUniformLocation(volume.box_program, "transform"), 1, GL_FALSE, glm::value_ptr(transform));
+            glUniform2f(glGetUniformLocation(volume.box_program, "viewport"), static_cast<float>(plot_type.width), static_cast<float>(plot_type.height));
+            glUniform1f(glGetUniformLocation(volume.box_program, "point_size"), volume.point_size);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthMask(GL_FALSE);
+            glBindVertexArray(volume.empty_vao);
+            for (size_t i = 0; i < tested.size(); i++)
+            {
+                const glm::vec3 &lo = volume.bounds[tested[i]->box * 2], &hi = volume.bounds[tested[i]->box * 2 + 1];
+                glUniform3f(glGetUniformLocation(volume.box_program, "lo"), lo.x, lo.y, lo.z);
+                glUniform3f(glGetUniformLocation(volume.box_program, "hi"), hi.x, hi.y, hi.z);
+                glBeginQuery(GL_ANY_SAMPLES_PASSED, volume.queries[i]);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glEndQuery(GL_ANY_SAMPLES_PASSED);
+            }
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthMask(GL_TRUE);
+
+            glUseProgram(program);
+            glBindVertexArray(plot_type.vao);
+            for (size_t i = 0; i < tested.size(); i++)
+            {
+                glBeginConditionalRender(volume.queries[i], GL_QUERY_BY_REGION_NO_WAIT);
+                draw_run(tested[i]->first, tested[i]->last);
+                glEndConditionalRender();
+            }
+        }
+        volume.queried = tested.size();
+        if (tested.empty())
+            volume.occluded_chunks = 0;
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glDisable(GL_DEPTH_TEST);
     }
     else
     {
-        status = "Nothing to plot with current selection";
+        // weighted blended order-independent transparency, without per target blend functions (gl 4.0) the two sums take a pass each
+        volume.queried = 0;
+        volume.occluded_chunks = 0;
+        glBindFramebuffer(GL_FRAMEBUFFER, volume.oit_fbo);
+        glViewport(0, 0, plot_type.width, plot_type.height);
+        glEnable(GL_BLEND);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, volume.accum, 0);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBlendFunc(GL_ONE, GL_ONE);
+        draw(1);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, volume.reveal, 0);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+        draw(2);
+        glDisable(GL_BLEND);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, plot_type.fbo);
+        glUseProgram(volume.composite_program);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, volume.accum);
+        glUniform1i(glGetUniformLocation(volume.composite_program, "accum"), 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, volume.reveal);
+        glUniform1i(glGetUniformLocation(volume.composite_program, "reveal"), 1);
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(volume.empty_vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    plot_type.drawn = plot_type.count;
+    plot_type.dirty = false;
+}
+
+void State::Invalidate()
+{
+    time_alt.dirty = lon_alt.dirty = alt_hist.dirty = lon_lat.dirty = alt_lat.dirty = view_3d.dirty = true;
+}
+
+bool State::Axis::Layout(float lo, float hi, int ticks)
+{
+    if (laid_out && lo == min && hi == max && ticks == max_ticks)
+        return false;
+
+    laid_out = true;
+    min = lo;
+    max = hi;
+    max_ticks = ticks;
+    positions.clear();
+    labels.clear();
+    label_sizes.clear();
+    if (!(hi > lo) || ticks < 2)
+        return true;
+
+    // rounds x to 1, 2, 5 or 10 times a power of ten (Heckbert's "nice numbers")
+    auto nice = [](double x, bool round)
+    {
+        double exponent = std::floor(std::log10(x));
+        double fraction = x / std::pow(10.0, exponent);
+        double nice_fraction;
+        if (round)
+            nice_fraction = fraction < 1.5 ? 1.0 : fraction < 3.0 ? 2.0 : fraction < 7.0 ? 5.0 : 10.0;
+        else
+            nice_fraction = fraction <= 1.0 ? 1.0 : fraction <= 2.0 ? 2.0 : fraction <= 5.0 ? 5.0 : 10.0;
+        return nice_fraction * std::pow(10.0, exponent);
+    };
+
+    double range = nice(static_cast<double>(hi) - lo, false);
+    double step = nice(range / (ticks - 1), true);
+    double first = std::ceil(lo / step) * step;
+    int decimals = std::max(0, -static_cast<int>(std::floor(std::log10(step))));
+    char label[32];
+    for (int i = 0;; i++)
+    {
+        double value = first + i * step;
+        if (value > hi + step * 1E-6)
+            break;
+        if (std::abs(value) < step * 1E-6)
+            value = 0.0; // avoids "-0" labels
+        positions.push_back(static_cast<float>((value - lo) / (static_cast<double>(hi) - lo)));
+        std::snprintf(label, sizeof(label), "%.*f", decimals, value);
+        labels.push_back(label);
     }
+    return true;
 }
 
 void State::Clear()
 {
-    // clearing all data in state.
-    return;
+    // the buffers keep their capacity for the next load
+    ClearSelection();
+    graphics.sources = 0;
+    time_alt.count = lon_alt.count = lon_lat.count = alt_lat.count = view_3d.count = 0;
+    graphics.volume.bounds.clear();
+    grid.Clear();
+    Invalidate();
+    status = "Cleared";
 }
\ No newline at end of file
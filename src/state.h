@@ -3,6 +3,12 @@
 
 #include <string>
 #include <vector>
+#include <array>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
 #include <duckdb.hpp>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -10,9 +16,22 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <fstream>
 #include <sstream>
+#include "maps.h"
+#include "grid.h"
 
 struct State
 {
+    enum Attribute // per-source values kept in their own gpu buffers, in the column order of the filter_query
+    {
+        Time,
+        Longitude,
+        Latitude,
+        Altitude,
+        Power,
+        Chi,
+        Stations,
+        AttributeCount
+    };
     struct Graphics
     {
         struct ColorMap
@@ -21,20 +40,81 @@ struct State
             GLuint texture;
             std::array<const char *, 5> options = {"Viridis", "Plasma", "Inferno", "Magma", "Cividis"};
         };
+        struct ColorBy
+        {
+            int index = 0;
+            bool equalize = false;         // histogram equalization instead of linear min/max normalization
+            float min = 0.0f, max = 1.0f;  // range of the attribute over the plotted sources
+            GLuint cdf;                    // cumulative histogram of the attribute, used as a lookup table when equalizing
+            std::array<const char *, 5> options = {"Time", "Altitude", "Power", "Chi", "Stations"};
+            std::array<Attribute, 5> attributes = {Time, Altitude, Power, Chi, Stations};
+        };
+        struct Reduction // tiny render targets the attribute buffers are blended into to get min/max and histograms
+        {
+            static constexpr int bins = 256;
+            GLuint program, fbo, vao, minmax, histogram;
+        };
+        struct Selection // brushed sources, shared by every plot
+        {
+            static constexpr int width = 4096; // mask texels per row, source i lives at (i % width, i / width)
+            GLuint program, region_program, fbo, mask, region, region_vao, region_vbo;
+            int rows = 0; // allocated mask rows
+            bool active = false;
+            size_t count = 0;
+            float time_min = 0.0f, time_max = 0.0f;        // seconds, like the time attribute
+            std::array<float, 3> alt_percentiles = {};     // 10th, 50th and 90th, to the nearest histogram bin
+        };
+        struct Volume // 3D view: orbit camera, per chunk bounds for culling and the weighted blended transparency targets
+        {
+            static constexpr size_t chunk = 65536; // sources per culling bounding box
+            static constexpr size_t occluders = 4; // nearest chunks drawn before the others are occlusion tested
+            float yaw = -0.6f, pitch = 0.5f;       // radians, camera around the middle of the sources
+            float distance = 2.5f;                 // in units of the largest half extent
+            float exaggeration = 1.0f;             // altitude scale against horizontal km
+            float point_size = 3.0f;               // sprite diameter in pixels
+            float opacity = 0.3f;                  // per sprite when transparent
+            bool transparent = false;              // order-independent transparency instead of depth tested sprites
+            GLuint program, composite_program, box_program, depth, oit_fbo, accum, reveal, empty_vao;
+            std::vector<GLuint> queries;           // one occlusion query per tested chunk, grown as needed
+            std::vector<glm::vec3> bounds;         // min and max of (lon, lat, alt) of every chunk, back to back
+            size_t visible_chunks = 0;             // chunks that passed frustum culling in the last render
+            size_t occluded_chunks = 0;            // of those, chunks whose box was hidden (opaque only, a frame late)
+            size_t queried = 0;                    // queries of the last opaque render whose results are not read yet
+        };
         GLuint shader_program;
+        GLuint map_program;
+        GLuint grid_program;
         bool initialized = false;
         ColorMap colormap;
+        ColorBy color_by;
+        Reduction reduction;
+        Selection selection;
+        Volume volume;
+        std::array<GLuint, AttributeCount> attributes; // one float per source for each attribute
         size_t sources = 0;
+        size_t capacity = 0;      // sources the attribute buffers have room for
+        double time_origin = 0.0; // ns since epoch that time is relative to
+    };
+    struct Axis
+    {
+        float min = 0.0f, max = 0.0f;       // extents the ticks were laid out for
+        int max_ticks = 0;                  // tick budget the ticks were laid out for
+        bool laid_out = false;
+        std::vector<float> positions;       // tick positions normalized to [0, 1] from min to max
+        std::vector<std::string> labels;    // formatted tick values
+        std::vector<glm::vec2> label_sizes; // text extents of the labels, measured once by the plot widget
+        bool Layout(float lo, float hi, int ticks); // computes "nice" ticks, returns false if nothing changed
     };
     struct Plot
     {
-        GLuint texture, fbo, vao, vbo;
-        float x_min, x_max, y_min, y_max;
-        int width, height;
-        std::array<std::string, 5> x_major_ticks = {"", "", "", "", ""};
-        // std::array<std::string, 5> x_minor_ticks = {"", "", "", "", ""};
-        std::array<std::string, 5> y_major_ticks = {"", "", "", "", ""};
-        // std::array<std::string, 5> y_minor_ticks = {"", "", "", "", ""};
+        GLuint texture, fbo, vao;
+        float x_min = 0.0f, x_max = 0.0f, y_min = 0.0f, y_max = 0.0f;
+        int width = 0, height = 0;                 // size of the panel, set by the plot widget every frame
+        int texture_width = 0, texture_height = 0; // size the fbo texture is currently allocated with
+        GLsizei count = 0;                         // sources drawn from the attribute buffers
+        GLsizei drawn = 0;                         // sources already rendered into the fbo
+        bool dirty = false;                        // data, colors or size changed since the last render
+        Axis x_axis, y_axis;
     };
     struct Filter
     {
@@ -45,17 +125,42 @@ struct State
         float max_chi = 5.0;
         float min_power = -60.0;
         float max_power = 60.0;
+        std::string station_order;      // station letters of the loaded network, first letter is the highest mask bit
+        uint32_t required_stations = 0; // mask bits every plotted source must have
+        uint32_t excluded_stations = 0; // mask bits no plotted source may have
+        bool time_window = false;       // only plot window_length minutes starting window_start minutes after the first source
+        float window_start = 0.0;
+        float window_length = 10.0;
     };
 
     std::string status = "Let's do this! :)";
     Filter filter;
     Graphics graphics;
     Plot time_alt, lon_alt, alt_hist, lon_lat, alt_lat;
+    Plot view_3d; // rotatable lon/lat/alt view, x/y extents unused
+    std::vector<MapLayer> maps; // overlays drawn under the sources in lon_lat
+    Grid grid;                  // gridded products of the filtered sources, a slice can be drawn under lon_lat
 
     // functions
-    void Clear();                                                        // TODO: not fully implemented yet
-    void Draw(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &res); // plots data using the output of the filter_query
-    void InitializeGraphics();                                           // initailzies the opengl shaders, colormaps, textures, etc.
+    void Append(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &res); // uploads filter_query rows after the ones already plotted
+    void BeginReduction(GLuint buffer, bool masked);                       // binds the reduction pass to an attribute buffer, optionally only counting selected sources
+    void Clear();                                                          // forgets the plotted sources, e.g. before loading from scratch
+    void ClearSelection();                                                 // unhighlights everything
+    void Draw(duckdb::unique_ptr<duckdb::MaterializedQueryResult> &res);   // uploads the output of the filter_query and marks the plots dirty
+    void DrawGrid(Plot &plot_type);                                        // draws the shown grid slice
+    void DrawMaps(Plot &plot_type);                                        // draws the visible map layers at the level of detail of the plot's zoom
+    void EndReduction();                                                   // restores the state BeginReduction changed
+    std::string FilterQuery(const std::string &rows, const std::string &time_origin) const; // sql for the plotted columns of the lma rows passing the filter
+    void InitializeGraphics();                                             // initailzies the opengl shaders, colormaps, textures, etc.
+    void Invalidate();                                                     // marks every plot for re-rendering, e.g. after a colormap change
+    void ReduceHistogram(GLuint buffer, glm::vec2 range, bool masked, std::array<double, Graphics::Reduction::bins> &histogram); // counts per bin over range
+    glm::vec2 ReduceRange(GLuint buffer, size_t first, bool masked);       // min and max of the buffer from source first on
+    void Render();                                                         // re-renders dirty plots into their fbos, resizing them first if needed
+    void Render3D();                                                       // re-renders view_3d from the orbit camera, culling chunks outside the frustum
+    void Reserve(size_t sources);                                          // grows the attribute buffers, keeping the sources already uploaded
+    void Select(Plot &plot_type, const std::vector<glm::vec2> &region);    // selects the sources inside a polygon in the data coordinates of plot_type
+    void UpdateColors(size_t first = 0);                                   // points the plots at the color by attribute and reduces its range on the gpu
+    glm::mat4 VolumeTransform() const;                                     // lon/lat/alt to clip space for view_3d
 };
 
 #endif
\ No newline at end of file
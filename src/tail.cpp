@@ -0,0 +1,167 @@
+#include "tail.h"
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+void Tail::Start(const std::string &path, std::unordered_map<std::string, uintmax_t> loaded, std::function<void()> on_sources)
+{
+    Stop();
+    directory = path;
+    notify = std::move(on_sources);
+    resume = std::move(loaded);
+    files.clear();
+    pending.Clear();
+    progress.clear();
+    running = true;
+    thread = std::thread(&Tail::Run, this);
+}
+
+void Tail::Stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+}
+
+bool Tail::Take(Sources &sources, std::unordered_map<std::string, uintmax_t> &read)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.Size() == 0 && progress.empty())
+        return false;
+    sources.Move(pending);
+    read = std::move(progress);
+    progress.clear();
+    return true;
+}
+
+void Tail::Run()
+{
+#ifdef __linux__
+    // inotify only wakes the thread up, the scan still decides what is new so missed or coalesced events do no harm
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0 && inotify_add_watch(fd, directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO) < 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+#endif
+    while (running)
+    {
+        Scan();
+#ifdef __linux__
+        if (fd >= 0)
+        {
+            pollfd poll_fd = {fd, POLLIN, 0};
+            if (poll(&poll_fd, 1, 250) > 0)
+            {
+                char events[4096];
+                while (read(fd, events, sizeof(events)) > 0)
+                    ;
+            }
+            continue;
+        }
+#endif
+        // polling fallback
+        for (int i = 0; i < 4 && running; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+#ifdef __linux__
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+void Tail::Scan()
+{
+    Sources sources;
+    std::unordered_map<std::string, uintmax_t> read;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string path = entry.path().string();
+        int64_t day_epoch;
+        if (!entry.is_regular_file(error) || IsGzip(path) || !LylDayEpoch(path, day_epoch))
+            continue; // compressed files cannot be read as they grow
+
+        uintmax_t size = entry.file_size(error);
+        if (error)
+            continue;
+        uintmax_t inode = 0;
+#ifdef __linux__
+        struct stat status;
+        if (stat(path.c_str(), &status) == 0)
+            inode = static_cast<uintmax_t>(status.st_ino);
+#endif
+        auto [found, added] = files.try_emplace(path);
+        File &file = found->second;
+        if (added)
+        {
+            // files loaded before going live continue after what is already in lma, past the header
+            auto loaded = resume.find(path);
+            if (loaded != resume.end() && loaded->second > 0)
+            {
+                file.offset = std::min(loaded->second, size);
+                file.parser.in_data = true;
+                char last = '\n';
+                std::ifstream stream(path, std::ios::binary);
+                stream.seekg(static_cast<std::streamoff>(file.offset) - 1);
+                stream.get(last);
+                file.resync = last != '\n';
+            }
+            file.inode = inode;
+        }
+        else if (size < file.offset || inode != file.inode)
+        {
+            // truncated, or rotated to a new file under the same name, read it again from the start
+            file = File();
+            file.inode = inode;
+        }
+        file.parser.day_epoch = day_epoch;
+        if (size <= file.offset)
+            continue;
+
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream)
+            continue;
+        stream.seekg(static_cast<std::streamoff>(file.offset));
+        std::string buffer = std::move(file.carry);
+        size_t carried = buffer.size();
+        buffer.resize(carried + (size - file.offset));
+        stream.read(buffer.data() + carried, static_cast<std::streamsize>(size - file.offset));
+        buffer.resize(carried + static_cast<size_t>(stream.gcount()));
+        file.offset += static_cast<uintmax_t>(stream.gcount());
+        read[path] = file.offset;
+
+        size_t start = 0;
+        if (file.resync)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(buffer.data(), '\n', buffer.size()));
+            if (!newline)
+                continue; // still inside the line that was already loaded
+            start = newline - buffer.data() + 1;
+            file.resync = false;
+        }
+        size_t consumed = file.parser.Parse(buffer.data() + start, buffer.data() + buffer.size(), sources);
+        file.carry = buffer.substr(start + consumed);
+    }
+
+    if (!read.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.Move(sources);
+            for (const auto &[path, offset] : read)
+                progress[path] = offset;
+        }
+        if (notify)
+            notify();
+    }
+}
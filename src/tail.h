@@ -0,0 +1,41 @@
+#ifndef TAIL_H
+#define TAIL_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include "lylout.h"
+
+struct Tail // watches a directory for LYLOUT files being written and parses whatever was appended to them
+{
+    struct File
+    {
+        uintmax_t offset = 0;  // bytes read so far
+        uintmax_t inode = 0;   // identity of the file the offset belongs to, where the platform has one
+        std::string carry;     // trailing partial line from the last read
+        bool resync = false;   // resumed mid-line, the rest of that line was already loaded
+        LylParser parser;
+    };
+
+    std::string directory;
+    std::function<void()> notify;                       // called from the watcher thread when new sources are ready
+    std::unordered_map<std::string, uintmax_t> resume; // bytes of files already loaded, read from there on when first seen
+    std::unordered_map<std::string, File> files;
+    Sources pending;
+    std::unordered_map<std::string, uintmax_t> progress; // files read since the last Take and how far
+    std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> running = false;
+
+    ~Tail() { Stop(); }
+    void Start(const std::string &path, std::unordered_map<std::string, uintmax_t> loaded, std::function<void()> on_sources);
+    void Stop();
+    bool Take(Sources &sources, std::unordered_map<std::string, uintmax_t> &read); // moves out what was parsed since the last call, false if nothing was
+    void Run();
+    void Scan(); // reads new bytes of every LYLOUT file in the directory
+};
+
+#endif